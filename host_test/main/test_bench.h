@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+// Helpers shared by the tests. Benchmarks print their figures rather than
+// assert on them; host timings vary too much for fixed limits.
+
+static inline int64_t bench_now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline double bench_per_s(uint64_t n, int64_t ns) {
+    return ns > 0 ? (double)n * 1e9 / (double)ns : 0.0;
+}
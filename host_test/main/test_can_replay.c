@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+#include "can_source.h"
+#include "obd_bridge.h"
+
+static can_source_t src;
+static can_replay_t replay;
+static char log_path[32];
+static int64_t clock_us;
+static uint32_t slept_ms;
+
+
+static int64_t fake_now_us(void) {
+    return clock_us;
+}
+
+
+static void fake_sleep_ms(uint32_t ms) {
+    clock_us += (int64_t)ms * 1000;
+    slept_ms += ms;
+}
+
+
+static void open_log(const char *contents) {
+    can_replay_config_t cfg = { .path = log_path, .now_us = fake_now_us, .sleep_ms = fake_sleep_ms };
+    FILE *f = fopen(log_path, "w");
+
+    TEST_ASSERT_NOT_NULL(f);
+    fputs(contents, f);
+    fclose(f);
+    TEST_ASSERT_TRUE(can_source_replay_open(&src, &replay, &cfg));
+}
+
+
+static void request_pid(uint8_t pid) {
+    can_frame_t req = { .id = OBD_REQUEST_ID, .dlc = 8, .data = { 2, OBD_MODE_CURRENT_DATA, pid } };
+
+    TEST_ASSERT_TRUE(src.send(&src, &req));
+}
+
+
+TEST_GROUP(can_replay);
+
+TEST_SETUP(can_replay) {
+    int fd;
+
+    strcpy(log_path, "/tmp/can_replay_XXXXXX");
+    fd = mkstemp(log_path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    close(fd);
+    clock_us = 1000000;
+    slept_ms = 0;
+    memset(&src, 0, sizeof(src));
+}
+
+TEST_TEAR_DOWN(can_replay) {
+    can_source_replay_close(&src);
+    unlink(log_path);
+}
+
+
+TEST(can_replay, parse_line) {
+    can_frame_t frame;
+
+    TEST_ASSERT_TRUE(can_replay_parse_line("(1436509052.249713) can0 7E8#03410D32\n", &frame));
+    TEST_ASSERT_EQUAL_HEX32(0x7E8, frame.id);
+    TEST_ASSERT_EQUAL_UINT8(4, frame.dlc);
+    TEST_ASSERT_EQUAL_HEX8(0x32, frame.data[3]);
+
+    // extended ID, byte separators, empty payload
+    TEST_ASSERT_TRUE(can_replay_parse_line("(0.0) can1 18DAF110#02.41.0C", &frame));
+    TEST_ASSERT_EQUAL_HEX32(0x18DAF110, frame.id);
+    TEST_ASSERT_EQUAL_UINT8(3, frame.dlc);
+    TEST_ASSERT_TRUE(can_replay_parse_line("can0 123#", &frame));
+    TEST_ASSERT_EQUAL_UINT8(0, frame.dlc);
+
+    // more than eight bytes stops at eight
+    TEST_ASSERT_TRUE(can_replay_parse_line("7E8#00112233445566778899", &frame));
+    TEST_ASSERT_EQUAL_UINT8(CAN_MAX_DLC, frame.dlc);
+    TEST_ASSERT_EQUAL_HEX8(0x77, frame.data[7]);
+
+    TEST_ASSERT_FALSE(can_replay_parse_line("", &frame));
+    TEST_ASSERT_FALSE(can_replay_parse_line("(1.0) can0 7E8 03410D32", &frame));
+    TEST_ASSERT_FALSE(can_replay_parse_line("(1.0) can0 #0341", &frame));
+    TEST_ASSERT_FALSE(can_replay_parse_line("(1.0) can0 123456789#00", &frame));
+    TEST_ASSERT_FALSE(can_replay_parse_line("(1.0) can0 7E8#034", &frame));
+}
+
+
+TEST(can_replay, parse_time) {
+    uint64_t us;
+
+    TEST_ASSERT_TRUE(can_replay_parse_time("(1436509052.249713) can0 7E8#00", &us));
+    TEST_ASSERT_TRUE(us == 1436509052249713ull);
+    TEST_ASSERT_TRUE(can_replay_parse_time("(2.5) can0 7E8#00", &us));
+    TEST_ASSERT_TRUE(us == 2500000);
+    TEST_ASSERT_TRUE(can_replay_parse_time("(3.1234567) can0 7E8#00", &us));
+    TEST_ASSERT_TRUE(us == 3123456);
+
+    TEST_ASSERT_FALSE(can_replay_parse_time("can0 7E8#00", &us));
+    TEST_ASSERT_FALSE(can_replay_parse_time("(1.0 can0 7E8#00", &us));
+    TEST_ASSERT_FALSE(can_replay_parse_time("(x) can0 7E8#00", &us));
+}
+
+
+TEST(can_replay, frames_follow_log_timestamps) {
+    can_frame_t frame;
+
+    open_log("(10.000000) can0 7E8#03410D10\n"
+             "(10.200000) can0 7E8#03410D20\n");
+
+    request_pid(0x0D);
+    TEST_ASSERT_TRUE(src.recv(&src, &frame, 10));
+    TEST_ASSERT_EQUAL_HEX8(0x10, frame.data[3]);
+    TEST_ASSERT_EQUAL_UINT32(0, slept_ms);
+
+    // the second frame is 200 ms out, a 50 ms wait sleeps and times out
+    request_pid(0x0D);
+    TEST_ASSERT_FALSE(src.recv(&src, &frame, 50));
+    TEST_ASSERT_EQUAL_UINT32(50, slept_ms);
+
+    TEST_ASSERT_TRUE(src.recv(&src, &frame, 500));
+    TEST_ASSERT_EQUAL_HEX8(0x20, frame.data[3]);
+    TEST_ASSERT_TRUE(clock_us == 1000000 + 200000);
+}
+
+
+TEST(can_replay, only_answers_to_requests) {
+    can_frame_t frame;
+
+    open_log("(1.000) can0 7E8#03410D10\n"
+             "(1.010) can0 7E8#03410433\n"
+             "(1.020) can0 7E8#03410D11\n");
+
+    // nothing asked for: due frames pass unseen, the call sleeps out its wait
+    TEST_ASSERT_FALSE(src.recv(&src, &frame, 5));
+    TEST_ASSERT_EQUAL_UINT32(1, replay.unrequested);
+    TEST_ASSERT_EQUAL_UINT32(5, slept_ms);
+
+    // load (0x04) is skipped while speed is outstanding
+    request_pid(0x0D);
+    TEST_ASSERT_TRUE(src.recv(&src, &frame, 100));
+    TEST_ASSERT_EQUAL_HEX8(0x11, frame.data[3]);
+    TEST_ASSERT_EQUAL_UINT32(2, replay.unrequested);
+
+    // one answer per request
+    TEST_ASSERT_FALSE(src.recv(&src, &frame, 0));
+}
+
+
+TEST(can_replay, unanswering_log_does_not_spin) {
+    can_frame_t frame;
+
+    open_log("7E8#03410433\n"
+             "garbage\n");
+
+    request_pid(0x0D);
+    TEST_ASSERT_FALSE(src.recv(&src, &frame, 20));
+    TEST_ASSERT_EQUAL_UINT32(20, slept_ms);
+    TEST_ASSERT_TRUE(replay.bad_lines >= 1);
+}
+
+
+TEST(can_replay, log_restarts_at_end) {
+    can_frame_t frame;
+
+    open_log("(5.0) can0 7E8#03410D01\n");
+
+    for (int i = 0; i < 3; i++) {
+        request_pid(0x0D);
+        TEST_ASSERT_TRUE(src.recv(&src, &frame, 10));
+        TEST_ASSERT_EQUAL_HEX8(0x01, frame.data[3]);
+    }
+}
+
+
+TEST_GROUP_RUNNER(can_replay) {
+    RUN_TEST_CASE(can_replay, parse_line);
+    RUN_TEST_CASE(can_replay, parse_time);
+    RUN_TEST_CASE(can_replay, frames_follow_log_timestamps);
+    RUN_TEST_CASE(can_replay, only_answers_to_requests);
+    RUN_TEST_CASE(can_replay, unanswering_log_does_not_spin);
+    RUN_TEST_CASE(can_replay, log_restarts_at_end);
+}
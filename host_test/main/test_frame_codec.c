@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+#include "frame_codec.h"
+#include "test_bench.h"
+
+#define BENCH_FRAMES        200000
+
+static frame_enc_t enc;
+static frame_dec_t dec;
+
+
+static uint32_t value_mask(uint8_t len) {
+    return len >= 4 ? UINT32_MAX : ((uint32_t)1 << (8 * len)) - 1;
+}
+
+
+TEST_GROUP(frame_codec);
+
+TEST_SETUP(frame_codec) {
+    frame_enc_begin(&enc, 0xBEEF, 0x1234);
+}
+
+TEST_TEAR_DOWN(frame_codec) {
+}
+
+
+TEST(frame_codec, round_trip_all_lengths) {
+    frame_record_t rec;
+    uint16_t len;
+
+    for (uint8_t n = 1; n <= FRAME_VALUE_MAX_LEN; n++) {
+        frame_record_t in = { .tag = n, .len = n, .value = 0xA1B2C3D4 & value_mask(n) };
+        TEST_ASSERT_TRUE(frame_enc_add(&enc, &in));
+    }
+    len = frame_enc_finish(&enc);
+    TEST_ASSERT_EQUAL_UINT16(FRAME_HEADER_LEN + 4 * 2 + 1 + 2 + 3 + 4, len);
+
+    TEST_ASSERT_TRUE(frame_dec_begin(&dec, enc.buf, len));
+    TEST_ASSERT_EQUAL_HEX16(0x1234, dec.seq);
+    TEST_ASSERT_EQUAL_HEX16(0xBEEF, dec.epoch);
+    for (uint8_t n = 1; n <= FRAME_VALUE_MAX_LEN; n++) {
+        TEST_ASSERT_TRUE(frame_dec_next(&dec, &rec));
+        TEST_ASSERT_EQUAL_UINT8(n, rec.tag);
+        TEST_ASSERT_EQUAL_UINT8(n, rec.len);
+        TEST_ASSERT_EQUAL_HEX32(0xA1B2C3D4 & value_mask(n), rec.value);
+    }
+    TEST_ASSERT_FALSE(frame_dec_next(&dec, &rec));
+}
+
+
+TEST(frame_codec, full_frame_refuses_and_keeps_contents) {
+    frame_record_t rec = { .tag = 7, .len = 4, .value = 0xDEADBEEF };
+    int added = 0;
+
+    while (frame_enc_add(&enc, &rec)) added++;
+    TEST_ASSERT_EQUAL_INT((FRAME_MAX_LEN - FRAME_HEADER_LEN) / FRAME_RECORD_MAX_LEN, added);
+
+    uint16_t before = enc.len;
+    TEST_ASSERT_FALSE(frame_enc_add(&enc, &rec));
+    TEST_ASSERT_EQUAL_UINT16(before, enc.len);
+    TEST_ASSERT_EQUAL_UINT8(added, enc.count);
+    TEST_ASSERT_LESS_OR_EQUAL(FRAME_MAX_LEN, frame_enc_finish(&enc));
+}
+
+
+TEST(frame_codec, encoder_rejects_bad_length) {
+    frame_record_t rec = { .tag = 1, .len = 0 };
+
+    TEST_ASSERT_FALSE(frame_enc_add(&enc, &rec));
+    rec.len = FRAME_VALUE_MAX_LEN + 1;
+    TEST_ASSERT_FALSE(frame_enc_add(&enc, &rec));
+    TEST_ASSERT_TRUE(frame_enc_empty(&enc));
+}
+
+
+TEST(frame_codec, decoder_rejects_bad_header) {
+    uint8_t buf[FRAME_HEADER_LEN] = { FRAME_VERSION };
+
+    TEST_ASSERT_FALSE(frame_dec_begin(&dec, buf, FRAME_HEADER_LEN - 1));
+    buf[0] = FRAME_VERSION + 1;
+    TEST_ASSERT_FALSE(frame_dec_begin(&dec, buf, sizeof(buf)));
+    // the previous format had no epoch
+    buf[0] = FRAME_VERSION - 1;
+    TEST_ASSERT_FALSE(frame_dec_begin(&dec, buf, sizeof(buf)));
+}
+
+
+TEST(frame_codec, decoder_stops_at_malformed_record) {
+    frame_record_t rec = { .tag = 1, .len = 2, .value = 0x0102 };
+    frame_record_t out;
+
+    frame_enc_add(&enc, &rec);
+    frame_enc_add(&enc, &rec);
+    frame_enc_add(&enc, &rec);
+    uint16_t len = frame_enc_finish(&enc);
+
+    // second record claims five value bytes
+    enc.buf[FRAME_HEADER_LEN + 4 + 1] = FRAME_VALUE_MAX_LEN + 1;
+    TEST_ASSERT_TRUE(frame_dec_begin(&dec, enc.buf, len));
+    TEST_ASSERT_TRUE(frame_dec_next(&dec, &out));
+    TEST_ASSERT_FALSE(frame_dec_next(&dec, &out));
+    TEST_ASSERT_FALSE(frame_dec_next(&dec, &out));
+}
+
+
+TEST(frame_codec, decoder_stops_at_truncation) {
+    frame_record_t rec = { .tag = 1, .len = 4, .value = 1 };
+    frame_record_t out;
+
+    frame_enc_add(&enc, &rec);
+    frame_enc_add(&enc, &rec);
+    uint16_t len = frame_enc_finish(&enc);
+
+    // header still claims two records, the second is cut short
+    TEST_ASSERT_TRUE(frame_dec_begin(&dec, enc.buf, len - 1));
+    TEST_ASSERT_TRUE(frame_dec_next(&dec, &out));
+    TEST_ASSERT_FALSE(frame_dec_next(&dec, &out));
+
+    // count larger than the records present
+    enc.buf[1] = 5;
+    TEST_ASSERT_TRUE(frame_dec_begin(&dec, enc.buf, len));
+    TEST_ASSERT_TRUE(frame_dec_next(&dec, &out));
+    TEST_ASSERT_TRUE(frame_dec_next(&dec, &out));
+    TEST_ASSERT_FALSE(frame_dec_next(&dec, &out));
+}
+
+
+// Random bytes behind a valid header must never make the decoder read past
+// the frame or return a record with an invalid length.
+TEST(frame_codec, decoder_survives_random_input) {
+    uint8_t buf[FRAME_MAX_LEN];
+    frame_record_t out;
+
+    srand(1);
+    for (int i = 0; i < 20000; i++) {
+        uint16_t len = (uint16_t)(rand() % (FRAME_MAX_LEN + 1));
+        for (uint16_t b = 0; b < len; b++) buf[b] = (uint8_t)rand();
+        if (len > 0) buf[0] = FRAME_VERSION;
+
+        if (!frame_dec_begin(&dec, buf, len)) {
+            TEST_ASSERT_LESS_THAN(FRAME_HEADER_LEN, len);
+            continue;
+        }
+        while (frame_dec_next(&dec, &out)) {
+            TEST_ASSERT_TRUE(out.len >= 1 && out.len <= FRAME_VALUE_MAX_LEN);
+            TEST_ASSERT_LESS_OR_EQUAL(len, dec.pos);
+        }
+    }
+}
+
+
+// Packs frames full of two-byte values, as the send task does for OBD-II
+// data, then decodes them again.
+TEST(frame_codec, throughput_benchmark) {
+    static frame_enc_t frames[64];
+    frame_record_t rec = { .len = 2 };
+    frame_record_t out;
+    uint64_t records = 0;
+    uint64_t bytes = 0;
+    uint32_t checksum = 0;
+
+    int64_t start = bench_now_ns();
+    for (uint32_t f = 0; f < BENCH_FRAMES; f++) {
+        frame_enc_t *e = &frames[f % 64];
+
+        frame_enc_begin(e, 1, (uint16_t)f);
+        for (rec.tag = 0; frame_enc_add(e, &rec); rec.tag++) {
+            rec.value = (rec.value + 1) & 0xFFFF;
+        }
+        bytes += frame_enc_finish(e);
+        records += e->count;
+    }
+    int64_t enc_ns = bench_now_ns() - start;
+
+    uint64_t decoded = 0;
+    start = bench_now_ns();
+    for (uint32_t f = 0; f < BENCH_FRAMES; f++) {
+        frame_enc_t *e = &frames[f % 64];
+
+        TEST_ASSERT_TRUE(frame_dec_begin(&dec, e->buf, e->len));
+        while (frame_dec_next(&dec, &out)) {
+            checksum += out.value;
+            decoded++;
+        }
+    }
+    int64_t dec_ns = bench_now_ns() - start;
+
+    printf("frame_codec: encode %.1f Mrec/s %.1f MB/s, decode %.1f Mrec/s %.1f MB/s (checksum %lu)\n",
+           bench_per_s(records, enc_ns) / 1e6, bench_per_s(bytes, enc_ns) / 1e6,
+           bench_per_s(decoded, dec_ns) / 1e6, bench_per_s(bytes, dec_ns) / 1e6, (unsigned long)checksum);
+
+    TEST_ASSERT_TRUE(records == decoded);
+}
+
+
+TEST_GROUP_RUNNER(frame_codec) {
+    RUN_TEST_CASE(frame_codec, round_trip_all_lengths);
+    RUN_TEST_CASE(frame_codec, full_frame_refuses_and_keeps_contents);
+    RUN_TEST_CASE(frame_codec, encoder_rejects_bad_length);
+    RUN_TEST_CASE(frame_codec, decoder_rejects_bad_header);
+    RUN_TEST_CASE(frame_codec, decoder_stops_at_malformed_record);
+    RUN_TEST_CASE(frame_codec, decoder_stops_at_truncation);
+    RUN_TEST_CASE(frame_codec, decoder_survives_random_input);
+    RUN_TEST_CASE(frame_codec, throughput_benchmark);
+}
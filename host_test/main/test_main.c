@@ -0,0 +1,20 @@
+#include "unity.h"
+#include "unity_fixture.h"
+
+
+static void run_all_tests(void) {
+    RUN_TEST_GROUP(pkt_pool);
+    RUN_TEST_GROUP(recv_ring);
+    RUN_TEST_GROUP(frame_codec);
+    RUN_TEST_GROUP(can_replay);
+    RUN_TEST_GROUP(obd_bridge);
+    RUN_TEST_GROUP(tx_sched);
+    RUN_TEST_GROUP(peer_table);
+    RUN_TEST_GROUP(telemetry);
+    RUN_TEST_GROUP(value_cache);
+}
+
+
+void app_main(void) {
+    UNITY_MAIN_FUNC(run_all_tests);
+}
@@ -0,0 +1,268 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+#include "can_source.h"
+#include "obd_bridge.h"
+#include "test_bench.h"
+
+#define PID_SPEED           0x0D
+#define PID_LOAD            0x04
+#define TAG_SPEED           1
+#define TAG_LOAD            2
+
+#define BENCH_LOG_FRAMES    2000    // 10 ms apart, alternating speed and load
+#define BENCH_SECONDS       120
+#define BENCH_QUEUE_DEPTH   8
+#define BENCH_DRAIN_MS      150     // one record leaves the send queue this often
+
+static const obd_pid_t pids[] = {
+    { .pid = PID_SPEED, .tag = TAG_SPEED, .len = 1, .poll_ms = 100, .refresh_ms = 1000 },
+    { .pid = PID_LOAD,  .tag = TAG_LOAD,  .len = 1, .poll_ms = 100, .refresh_ms = 1000 },
+};
+
+static obd_bridge_t bridge;
+static int64_t clock_us;
+
+
+static can_frame_t response(uint8_t pid, uint8_t value) {
+    can_frame_t frame = { .id = OBD_RESPONSE_ID_BASE, .dlc = 8, .data = { 3, OBD_MODE_CURRENT_DATA_REPLY, pid, value } };
+    return frame;
+}
+
+
+static int64_t fake_now_us(void) {
+    return clock_us;
+}
+
+
+static void fake_sleep_ms(uint32_t ms) {
+    clock_us += (int64_t)ms * 1000;
+}
+
+
+TEST_GROUP(obd_bridge);
+
+TEST_SETUP(obd_bridge) {
+    TEST_ASSERT_TRUE(obd_bridge_init(&bridge, pids, sizeof(pids) / sizeof(pids[0])));
+}
+
+TEST_TEAR_DOWN(obd_bridge) {
+}
+
+
+TEST(obd_bridge, requests_round_robin_and_time_out) {
+    can_frame_t req;
+
+    TEST_ASSERT_TRUE(obd_bridge_next_request(&bridge, 1000, 8, &req));
+    TEST_ASSERT_EQUAL_HEX32(OBD_REQUEST_ID, req.id);
+    TEST_ASSERT_EQUAL_HEX8(PID_SPEED, req.data[2]);
+
+    // one request at a time until it is answered or times out
+    TEST_ASSERT_FALSE(obd_bridge_next_request(&bridge, 1010, 8, &req));
+    TEST_ASSERT_TRUE(obd_bridge_next_request(&bridge, 1000 + OBD_RESPONSE_TIMEOUT_MS, 8, &req));
+    TEST_ASSERT_EQUAL_HEX8(PID_LOAD, req.data[2]);
+    TEST_ASSERT_EQUAL_UINT32(1, bridge.stats.timeouts);
+}
+
+
+TEST(obd_bridge, rejects_foreign_frames) {
+    can_frame_t frame = response(PID_SPEED, 1);
+
+    frame.id = 0x7E0;
+    TEST_ASSERT_FALSE(obd_bridge_on_frame(&bridge, &frame, 0));
+    frame = response(PID_SPEED, 1);
+    frame.data[1] = 0x42;
+    TEST_ASSERT_FALSE(obd_bridge_on_frame(&bridge, &frame, 0));
+    frame = response(0x05, 1);
+    TEST_ASSERT_FALSE(obd_bridge_on_frame(&bridge, &frame, 0));
+    frame = response(PID_SPEED, 1);
+    frame.data[0] = 2; // PCI length leaves no room for the value
+    TEST_ASSERT_FALSE(obd_bridge_on_frame(&bridge, &frame, 0));
+    TEST_ASSERT_EQUAL_UINT32(0, bridge.stats.responses);
+}
+
+
+// Unchanged values are only forwarded again once their refresh period ran out
+TEST(obd_bridge, suppresses_unchanged_values) {
+    can_frame_t frame = response(PID_SPEED, 42);
+    frame_record_t rec;
+
+    TEST_ASSERT_TRUE(obd_bridge_on_frame(&bridge, &frame, 1000));
+    TEST_ASSERT_TRUE(obd_bridge_take(&bridge, 1000, &rec, NULL));
+    TEST_ASSERT_EQUAL_UINT8(TAG_SPEED, rec.tag);
+    TEST_ASSERT_EQUAL_UINT32(42, rec.value);
+
+    TEST_ASSERT_TRUE(obd_bridge_on_frame(&bridge, &frame, 1500));
+    TEST_ASSERT_FALSE(obd_bridge_take(&bridge, 1500, &rec, NULL));
+    TEST_ASSERT_EQUAL_UINT32(1, bridge.stats.suppressed);
+
+    TEST_ASSERT_TRUE(obd_bridge_on_frame(&bridge, &frame, 2000));
+    TEST_ASSERT_TRUE(obd_bridge_take(&bridge, 2000, &rec, NULL));
+    TEST_ASSERT_EQUAL_UINT32(2, bridge.stats.forwarded);
+}
+
+
+// A PID holds one pending value; a newer one replaces it, along with the
+// time it arrived
+TEST(obd_bridge, coalesces_pending_values) {
+    can_frame_t frame;
+    frame_record_t rec;
+    uint32_t value_ms;
+
+    frame = response(PID_SPEED, 10);
+    obd_bridge_on_frame(&bridge, &frame, 1000);
+    frame = response(PID_SPEED, 11);
+    obd_bridge_on_frame(&bridge, &frame, 1010);
+
+    TEST_ASSERT_TRUE(obd_bridge_take(&bridge, 1020, &rec, &value_ms));
+    TEST_ASSERT_EQUAL_UINT32(11, rec.value);
+    TEST_ASSERT_EQUAL_UINT32(1010, value_ms);
+    TEST_ASSERT_FALSE(obd_bridge_take(&bridge, 1020, &rec, NULL));
+    TEST_ASSERT_EQUAL_UINT32(1, bridge.stats.coalesced);
+
+    // forwarding is rate limited to the poll period
+    frame = response(PID_SPEED, 12);
+    obd_bridge_on_frame(&bridge, &frame, 1050);
+    TEST_ASSERT_FALSE(obd_bridge_take(&bridge, 1050, &rec, NULL));
+    TEST_ASSERT_TRUE(obd_bridge_take(&bridge, 1120, &rec, NULL));
+}
+
+
+// A response stamped after the caller read its clock is never reported as
+// arriving in the future
+TEST(obd_bridge, value_time_not_after_now) {
+    can_frame_t frame = response(PID_SPEED, 42);
+    frame_record_t rec;
+    uint32_t value_ms;
+
+    obd_bridge_on_frame(&bridge, &frame, 1010);
+    TEST_ASSERT_TRUE(obd_bridge_take(&bridge, 1000, &rec, &value_ms));
+    TEST_ASSERT_EQUAL_UINT32(1000, value_ms);
+
+    // across the millisecond counter wrapping
+    frame = response(PID_LOAD, 7);
+    obd_bridge_on_frame(&bridge, &frame, 5);
+    TEST_ASSERT_TRUE(obd_bridge_take(&bridge, UINT32_MAX - 4, &rec, &value_ms));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX - 4, value_ms);
+}
+
+
+// A full send queue stops polling and a record that could not be queued
+// goes back, losing out to a newer value if one arrived meanwhile
+TEST(obd_bridge, back_pressure) {
+    can_frame_t frame;
+    can_frame_t req;
+    frame_record_t rec;
+
+    TEST_ASSERT_FALSE(obd_bridge_next_request(&bridge, 1000, OBD_BRIDGE_MIN_SEND_SPACE - 1, &req));
+    TEST_ASSERT_EQUAL_UINT32(1, bridge.stats.throttled);
+    TEST_ASSERT_EQUAL_UINT32(0, bridge.stats.requests);
+
+    frame = response(PID_LOAD, 50);
+    obd_bridge_on_frame(&bridge, &frame, 1000);
+    TEST_ASSERT_TRUE(obd_bridge_take(&bridge, 1000, &rec, NULL));
+    obd_bridge_requeue(&bridge, &rec);
+    TEST_ASSERT_EQUAL_UINT32(0, bridge.stats.forwarded);
+
+    frame = response(PID_LOAD, 51);
+    obd_bridge_on_frame(&bridge, &frame, 1010);
+    TEST_ASSERT_TRUE(obd_bridge_take(&bridge, 1010, &rec, NULL));
+    TEST_ASSERT_EQUAL_UINT32(51, rec.value);
+    TEST_ASSERT_EQUAL_UINT32(1, bridge.stats.forwarded);
+}
+
+
+// Runs the bridge task's loop against a replayed log on a simulated clock,
+// with a send queue that drains slower than the bus answers, and reports
+// what reached the queue and what the host spent per loop.
+TEST(obd_bridge, replay_benchmark) {
+    can_source_t src;
+    can_replay_t replay;
+    can_replay_config_t cfg = { .now_us = fake_now_us, .sleep_ms = fake_sleep_ms };
+    char path[] = "/tmp/obd_bridge_XXXXXX";
+    uint32_t queued = 0;
+    uint32_t loops = 0;
+    uint32_t received = 0;
+    uint32_t max_queued = 0;
+    int64_t next_drain_us;
+    can_frame_t frame;
+    frame_record_t rec;
+
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    FILE *f = fdopen(fd, "w");
+    for (int i = 0; i < BENCH_LOG_FRAMES; i++) {
+        // speed ramps slowly so it changes every few samples, load is steady
+        uint8_t pid = (i & 1) ? PID_LOAD : PID_SPEED;
+        uint8_t value = (i & 1) ? 40 : (uint8_t)(i / 16);
+        fprintf(f, "(%d.%06d) can0 7E8#0341%02X%02X\n", 100 + i / 100, (i % 100) * 10000, pid, value);
+    }
+    fclose(f);
+
+    clock_us = 1000000;
+    next_drain_us = clock_us;
+    cfg.path = path;
+    TEST_ASSERT_TRUE(can_source_replay_open(&src, &replay, &cfg));
+
+    int64_t start = bench_now_ns();
+    while (clock_us < 1000000 + BENCH_SECONDS * 1000000LL) {
+        uint32_t now = (uint32_t)(clock_us / 1000);
+
+        while (clock_us >= next_drain_us) {
+            if (queued > 0) queued--;
+            next_drain_us += BENCH_DRAIN_MS * 1000;
+        }
+
+        if (obd_bridge_next_request(&bridge, now, BENCH_QUEUE_DEPTH - queued, &frame)) {
+            src.send(&src, &frame);
+        }
+        if (src.recv(&src, &frame, 10)) {
+            obd_bridge_on_frame(&bridge, &frame, (uint32_t)(clock_us / 1000));
+            received++;
+        }
+        while (obd_bridge_take(&bridge, now, &rec, NULL)) {
+            if (queued == BENCH_QUEUE_DEPTH) {
+                obd_bridge_requeue(&bridge, &rec);
+                break;
+            }
+            queued++;
+        }
+        if (queued > max_queued) max_queued = queued;
+        loops++;
+    }
+    int64_t elapsed = bench_now_ns() - start;
+
+    can_source_replay_close(&src);
+    unlink(path);
+
+    printf("obd_bridge replay: %u s simulated, %lu requests, %lu responses, %lu forwarded, %lu suppressed, "
+           "%lu coalesced, %lu throttled, %lu timeouts, %lu unrequested, %.0f ns per loop\n",
+           BENCH_SECONDS, (unsigned long)bridge.stats.requests, (unsigned long)bridge.stats.responses,
+           (unsigned long)bridge.stats.forwarded, (unsigned long)bridge.stats.suppressed,
+           (unsigned long)bridge.stats.coalesced, (unsigned long)bridge.stats.throttled,
+           (unsigned long)bridge.stats.timeouts, (unsigned long)replay.unrequested, (double)elapsed / loops);
+
+    TEST_ASSERT_EQUAL_UINT32(received, bridge.stats.responses);
+    TEST_ASSERT_GREATER_THAN(0, bridge.stats.forwarded);
+    TEST_ASSERT_GREATER_THAN(0, bridge.stats.suppressed);
+    TEST_ASSERT_GREATER_THAN(0, bridge.stats.throttled);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(BENCH_QUEUE_DEPTH, max_queued);
+    // the queue drains one record per BENCH_DRAIN_MS, nothing gets past that
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(BENCH_SECONDS * 1000 / BENCH_DRAIN_MS + BENCH_QUEUE_DEPTH,
+                                     bridge.stats.forwarded);
+}
+
+
+TEST_GROUP_RUNNER(obd_bridge) {
+    RUN_TEST_CASE(obd_bridge, requests_round_robin_and_time_out);
+    RUN_TEST_CASE(obd_bridge, rejects_foreign_frames);
+    RUN_TEST_CASE(obd_bridge, suppresses_unchanged_values);
+    RUN_TEST_CASE(obd_bridge, coalesces_pending_values);
+    RUN_TEST_CASE(obd_bridge, value_time_not_after_now);
+    RUN_TEST_CASE(obd_bridge, back_pressure);
+    RUN_TEST_CASE(obd_bridge, replay_benchmark);
+}
@@ -0,0 +1,309 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+#include "peer_table.h"
+#include "test_bench.h"
+
+#define BENCH_OPS           1000000
+#define SIM_NODES           12
+#define SIM_CROWD           (PEER_TABLE_MAX + 6)
+#define SIM_LOSS_PERMILLE   300
+#define SIM_ROUND_MS        100
+
+static peer_table_t table;
+static peer_learn_result_t learned;
+
+
+static void make_addr(uint8_t *addr, uint32_t n) {
+    addr[0] = 0x02;
+    addr[1] = 0x00;
+    addr[2] = (uint8_t)(n >> 24);
+    addr[3] = (uint8_t)(n >> 16);
+    addr[4] = (uint8_t)(n >> 8);
+    addr[5] = (uint8_t)n;
+}
+
+
+static uint32_t bucket_holding(const peer_table_t *t, uint8_t slot) {
+    for (uint32_t b = 0; b < PEER_TABLE_BUCKETS; b++) {
+        if (t->buckets[b] == slot) return b;
+    }
+    return PEER_TABLE_BUCKETS;
+}
+
+
+// Home bucket of addr: where it lands in an empty table
+static uint32_t home_bucket(const uint8_t *addr) {
+    peer_table_t t;
+
+    peer_table_init(&t, 1);
+    return bucket_holding(&t, peer_table_learn(&t, addr, 0, &learned));
+}
+
+
+// Every live peer is findable, every indexed slot is live, and no probe run
+// has a hole between a peer's home bucket and the bucket it sits in.
+static void check_table(const peer_table_t *t) {
+    uint32_t live = 0;
+
+    for (uint8_t slot = 0; slot < t->slots; slot++) {
+        const peer_entry_t *e = &t->entries[slot];
+        if (!e->in_use) continue;
+        live++;
+
+        TEST_ASSERT_EQUAL_UINT8(slot, peer_table_find(t, e->addr));
+        uint32_t at = bucket_holding(t, slot);
+        for (uint32_t b = home_bucket(e->addr); b != at; b = (b + 1) % PEER_TABLE_BUCKETS) {
+            TEST_ASSERT_TRUE_MESSAGE(t->buckets[b] != PEER_NONE, "hole in probe run");
+        }
+    }
+    for (uint32_t b = 0; b < PEER_TABLE_BUCKETS; b++) {
+        if (t->buckets[b] != PEER_NONE) TEST_ASSERT_TRUE(t->entries[t->buckets[b]].in_use);
+    }
+    TEST_ASSERT_EQUAL_UINT32(t->count, live);
+}
+
+
+TEST_GROUP(peer_table);
+
+TEST_SETUP(peer_table) {
+    peer_table_init(&table, PEER_TABLE_MAX);
+}
+
+TEST_TEAR_DOWN(peer_table) {
+}
+
+
+TEST(peer_table, learn_find_and_evict_lru) {
+    uint8_t addr[PEER_ADDR_LEN];
+
+    for (uint32_t n = 0; n < PEER_TABLE_MAX; n++) {
+        make_addr(addr, n);
+        TEST_ASSERT_EQUAL_UINT8(n, peer_table_learn(&table, addr, n, &learned));
+        TEST_ASSERT_TRUE(learned.added);
+    }
+
+    // hearing peer 0 again moves it away from the LRU end
+    make_addr(addr, 0);
+    TEST_ASSERT_EQUAL_UINT8(0, peer_table_learn(&table, addr, 100, &learned));
+    TEST_ASSERT_FALSE(learned.added);
+
+    make_addr(addr, 1000);
+    uint8_t slot = peer_table_learn(&table, addr, 101, &learned);
+    TEST_ASSERT_TRUE(learned.evicted);
+    TEST_ASSERT_EQUAL_UINT8(1, slot);
+    make_addr(addr, 1);
+    TEST_ASSERT_EQUAL_MEMORY(addr, learned.evicted_addr, PEER_ADDR_LEN);
+    TEST_ASSERT_EQUAL_UINT8(PEER_NONE, peer_table_find(&table, addr));
+    TEST_ASSERT_EQUAL_UINT32(1, table.evictions);
+    check_table(&table);
+}
+
+
+// Three peers share home bucket 31, one more lives at 0, so the run wraps.
+// Removing the first must pull each later entry back without stranding the
+// one whose home is in the middle of the run.
+TEST(peer_table, remove_shifts_probe_run_back) {
+    uint8_t addrs[4][PEER_ADDR_LEN];
+    const uint32_t homes[4] = { PEER_TABLE_BUCKETS - 1, PEER_TABLE_BUCKETS - 1, 0, PEER_TABLE_BUCKETS - 1 };
+    uint8_t slots[4];
+    uint32_t n = 0;
+
+    for (int i = 0; i < 4; i++) {
+        do make_addr(addrs[i], n++); while (home_bucket(addrs[i]) != homes[i]);
+    }
+
+    for (int i = 0; i < 4; i++) slots[i] = peer_table_learn(&table, addrs[i], 0, &learned);
+    TEST_ASSERT_EQUAL_UINT32(PEER_TABLE_BUCKETS - 1, bucket_holding(&table, slots[0]));
+    TEST_ASSERT_EQUAL_UINT32(0, bucket_holding(&table, slots[1]));
+    TEST_ASSERT_EQUAL_UINT32(1, bucket_holding(&table, slots[2]));
+    TEST_ASSERT_EQUAL_UINT32(2, bucket_holding(&table, slots[3]));
+
+    peer_table_remove(&table, slots[0]);
+
+    TEST_ASSERT_EQUAL_UINT8(PEER_NONE, peer_table_find(&table, addrs[0]));
+    TEST_ASSERT_EQUAL_UINT32(PEER_TABLE_BUCKETS - 1, bucket_holding(&table, slots[1]));
+    TEST_ASSERT_EQUAL_UINT32(0, bucket_holding(&table, slots[2]));
+    TEST_ASSERT_EQUAL_UINT32(1, bucket_holding(&table, slots[3]));
+    TEST_ASSERT_EQUAL_UINT8(PEER_NONE, table.buckets[2]);
+    TEST_ASSERT_EQUAL_UINT32(3, table.count);
+    check_table(&table);
+}
+
+
+// The freed slot goes to the next new peer, the table keeps its shape
+// through random churn
+TEST(peer_table, remove_and_reuse_under_churn) {
+    uint8_t addr[PEER_ADDR_LEN];
+
+    srand(5);
+    for (int i = 0; i < 20000; i++) {
+        make_addr(addr, (uint32_t)(rand() % 64));
+        uint8_t slot = peer_table_find(&table, addr);
+
+        if (slot != PEER_NONE && rand() % 2) {
+            peer_table_remove(&table, slot);
+            TEST_ASSERT_FALSE(table.entries[slot].in_use);
+        } else {
+            slot = peer_table_learn(&table, addr, (uint32_t)i, &learned);
+            TEST_ASSERT_LESS_THAN(PEER_TABLE_MAX, slot);
+        }
+        TEST_ASSERT_LESS_OR_EQUAL(table.slots, table.count);
+        if ((i & 63) == 0) check_table(&table);
+    }
+    check_table(&table);
+    TEST_ASSERT_GREATER_THAN(0, table.removals);
+}
+
+
+TEST(peer_table, oldest_idle_ages_from_lru_end) {
+    uint8_t addr[PEER_ADDR_LEN];
+    uint8_t slot;
+
+    for (uint32_t n = 0; n < 5; n++) {
+        make_addr(addr, n);
+        peer_table_learn(&table, addr, n * 1000, &learned);
+    }
+
+    TEST_ASSERT_EQUAL_UINT8(PEER_NONE, peer_table_oldest_idle(&table, 10000, 10000));
+
+    int aged = 0;
+    while ((slot = peer_table_oldest_idle(&table, 12500, 10000)) != PEER_NONE) {
+        TEST_ASSERT_EQUAL_UINT8(aged, slot);
+        peer_table_remove(&table, slot);
+        aged++;
+    }
+    TEST_ASSERT_EQUAL_INT(3, aged);
+    TEST_ASSERT_EQUAL_UINT32(2, table.count);
+
+    // the next new peer reuses a freed slot
+    make_addr(addr, 99);
+    TEST_ASSERT_LESS_THAN(3, peer_table_learn(&table, addr, 13000, &learned));
+    TEST_ASSERT_EQUAL_UINT8(5, table.slots);
+    check_table(&table);
+}
+
+
+// Every node broadcasts once a round over a lossy medium and learns whoever
+// it hears. Reports how many rounds it takes for every table to hold every
+// other node, then lets one node leave and checks the others age it out.
+TEST(peer_table, discovery_converges) {
+    static peer_table_t nodes[SIM_NODES];
+    uint8_t addrs[SIM_NODES][PEER_ADDR_LEN];
+    uint32_t rounds = 0;
+    uint32_t timeout_ms = 10 * SIM_ROUND_MS;
+    bool converged = false;
+
+    srand(11);
+    for (int i = 0; i < SIM_NODES; i++) {
+        make_addr(addrs[i], 0x1000 + (uint32_t)i);
+        peer_table_init(&nodes[i], PEER_TABLE_MAX - 1);
+    }
+
+    while (!converged && rounds < 1000) {
+        uint32_t now = ++rounds * SIM_ROUND_MS;
+
+        converged = true;
+        for (int tx = 0; tx < SIM_NODES; tx++) {
+            for (int rx = 0; rx < SIM_NODES; rx++) {
+                if (rx != tx && rand() % 1000 >= SIM_LOSS_PERMILLE) peer_table_learn(&nodes[rx], addrs[tx], now, &learned);
+            }
+        }
+        for (int i = 0; i < SIM_NODES; i++) {
+            if (nodes[i].count != SIM_NODES - 1) converged = false;
+        }
+    }
+    printf("peer_table: %d nodes at %d%% loss converged in %lu rounds\n", SIM_NODES, SIM_LOSS_PERMILLE / 10, (unsigned long)rounds);
+    TEST_ASSERT_TRUE(converged);
+
+    // node 0 goes quiet; the others drop it once the timeout ran out
+    for (uint32_t r = 0; r < 2 * timeout_ms / SIM_ROUND_MS; r++) {
+        uint32_t now = ++rounds * SIM_ROUND_MS;
+
+        for (int tx = 1; tx < SIM_NODES; tx++) {
+            for (int rx = 1; rx < SIM_NODES; rx++) {
+                if (rx != tx) peer_table_learn(&nodes[rx], addrs[tx], now, &learned);
+            }
+        }
+        for (int rx = 1; rx < SIM_NODES; rx++) {
+            uint8_t slot;
+            while ((slot = peer_table_oldest_idle(&nodes[rx], now, timeout_ms)) != PEER_NONE) {
+                peer_table_remove(&nodes[rx], slot);
+            }
+        }
+    }
+    for (int rx = 1; rx < SIM_NODES; rx++) {
+        TEST_ASSERT_EQUAL_UINT8(PEER_NONE, peer_table_find(&nodes[rx], addrs[0]));
+        TEST_ASSERT_EQUAL_UINT32(SIM_NODES - 2, nodes[rx].count);
+        check_table(&nodes[rx]);
+    }
+}
+
+
+// More nodes than a table holds: every table stays full and keeps the
+// most recently heard ones
+TEST(peer_table, crowd_keeps_most_recent) {
+    uint8_t addrs[SIM_CROWD][PEER_ADDR_LEN];
+
+    peer_table_init(&table, PEER_TABLE_MAX - 1);
+    for (int i = 0; i < SIM_CROWD; i++) make_addr(addrs[i], 0x2000 + (uint32_t)i);
+
+    for (uint32_t round = 1; round <= 5; round++) {
+        for (int tx = 0; tx < SIM_CROWD; tx++) peer_table_learn(&table, addrs[tx], round * 1000 + (uint32_t)tx, &learned);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(PEER_TABLE_MAX - 1, table.count);
+    for (int tx = SIM_CROWD - (PEER_TABLE_MAX - 1); tx < SIM_CROWD; tx++) {
+        TEST_ASSERT_TRUE(peer_table_find(&table, addrs[tx]) != PEER_NONE);
+    }
+    check_table(&table);
+}
+
+
+// Lookups and learns with the table full, as the receive path sees them
+TEST(peer_table, lookup_benchmark_at_max_peers) {
+    uint8_t addrs[2 * PEER_TABLE_MAX][PEER_ADDR_LEN];
+    uint32_t hits = 0;
+
+    for (uint32_t n = 0; n < 2 * PEER_TABLE_MAX; n++) make_addr(addrs[n], 0xA000 + n * 7919);
+    for (uint32_t n = 0; n < PEER_TABLE_MAX; n++) peer_table_learn(&table, addrs[n], 0, &learned);
+
+    int64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_OPS; i++) {
+        if (peer_table_find(&table, addrs[i % (2 * PEER_TABLE_MAX)]) != PEER_NONE) hits++;
+    }
+    int64_t find_ns = bench_now_ns() - start;
+
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_OPS; i++) {
+        peer_table_learn(&table, addrs[i % PEER_TABLE_MAX], i, &learned);
+    }
+    int64_t learn_ns = bench_now_ns() - start;
+
+    // every learn is a new peer and evicts the oldest
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_OPS; i++) {
+        peer_table_learn(&table, addrs[i % (2 * PEER_TABLE_MAX)], i, &learned);
+    }
+    int64_t churn_ns = bench_now_ns() - start;
+
+    printf("peer_table at %d peers: find %.1f ns (half misses), learn known %.1f ns, learn with eviction %.1f ns\n",
+           PEER_TABLE_MAX, (double)find_ns / BENCH_OPS, (double)learn_ns / BENCH_OPS, (double)churn_ns / BENCH_OPS);
+
+    TEST_ASSERT_EQUAL_UINT32(BENCH_OPS / 2, hits);
+    check_table(&table);
+}
+
+
+TEST_GROUP_RUNNER(peer_table) {
+    RUN_TEST_CASE(peer_table, learn_find_and_evict_lru);
+    RUN_TEST_CASE(peer_table, remove_shifts_probe_run_back);
+    RUN_TEST_CASE(peer_table, remove_and_reuse_under_churn);
+    RUN_TEST_CASE(peer_table, oldest_idle_ages_from_lru_end);
+    RUN_TEST_CASE(peer_table, discovery_converges);
+    RUN_TEST_CASE(peer_table, crowd_keeps_most_recent);
+    RUN_TEST_CASE(peer_table, lookup_benchmark_at_max_peers);
+}
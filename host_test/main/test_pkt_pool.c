@@ -0,0 +1,248 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+#include "pkt_pool.h"
+#include "test_bench.h"
+
+#define STRESS_PRODUCERS    4
+#define STRESS_CONSUMERS    2
+#define STRESS_PER_PRODUCER 50000
+#define BENCH_PAIRS         1000000
+#define BENCH_THREADS       STRESS_PRODUCERS
+#define BENCH_YIELD_EVERY   4096    // one CPU is enough to interleave the threads
+
+// Hand-over between producers and consumers, standing in for the receive
+// queue. Only slot indices travel through it, as in the application.
+typedef struct {
+    pthread_mutex_t lock;
+    uint8_t idx[PKT_POOL_SLOTS];
+    uint32_t head;
+    uint32_t count;
+} handover_t;
+
+static pkt_pool_t pool;
+static handover_t handover;
+static atomic_uint owners[PKT_POOL_SLOTS];
+static atomic_uint producers_left;
+static atomic_uint consumed;
+static atomic_uint double_owned;
+static atomic_uint corrupted;
+
+
+static bool handover_push(uint8_t idx) {
+    bool ok = false;
+
+    pthread_mutex_lock(&handover.lock);
+    if (handover.count < PKT_POOL_SLOTS) {
+        handover.idx[(handover.head + handover.count++) % PKT_POOL_SLOTS] = idx;
+        ok = true;
+    }
+    pthread_mutex_unlock(&handover.lock);
+    return ok;
+}
+
+
+static uint8_t handover_pop(void) {
+    uint8_t idx = PKT_POOL_INVALID;
+
+    pthread_mutex_lock(&handover.lock);
+    if (handover.count > 0) {
+        idx = handover.idx[handover.head];
+        handover.head = (handover.head + 1) % PKT_POOL_SLOTS;
+        handover.count--;
+    }
+    pthread_mutex_unlock(&handover.lock);
+    return idx;
+}
+
+
+static void *producer(void *arg) {
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+
+    for (uint32_t n = 0; n < STRESS_PER_PRODUCER; ) {
+        uint8_t idx = pkt_pool_alloc(&pool);
+        if (idx == PKT_POOL_INVALID) {
+            sched_yield();
+            continue;
+        }
+
+        if (atomic_exchange(&owners[idx], 1) != 0) atomic_fetch_add(&double_owned, 1);
+
+        esp_now_data_packet_buff_t *pkt = pkt_pool_slot(&pool, idx);
+        pkt->len = sizeof(uint32_t) * 2;
+        memcpy(pkt->data, &id, sizeof(id));
+        memcpy(pkt->data + sizeof(id), &n, sizeof(n));
+        memset(pkt->data + pkt->len, (int)(n & 0xFF), PKT_POOL_MTU - pkt->len);
+
+        while (!handover_push(idx)) {
+            sched_yield();
+        }
+        n++;
+    }
+
+    atomic_fetch_sub(&producers_left, 1);
+    return NULL;
+}
+
+
+static void *consumer(void *arg) {
+    (void)arg;
+
+    for (;;) {
+        uint8_t idx = handover_pop();
+
+        if (idx == PKT_POOL_INVALID) {
+            if (atomic_load(&producers_left) != 0) {
+                sched_yield();
+                continue;
+            }
+            // nothing is pushed once the producers are done
+            idx = handover_pop();
+            if (idx == PKT_POOL_INVALID) break;
+        }
+
+        esp_now_data_packet_buff_t *pkt = pkt_pool_slot(&pool, idx);
+        uint32_t n;
+        memcpy(&n, pkt->data + sizeof(uint32_t), sizeof(n));
+        for (size_t i = pkt->len; i < PKT_POOL_MTU; i++) {
+            if (pkt->data[i] != (uint8_t)n) {
+                atomic_fetch_add(&corrupted, 1);
+                break;
+            }
+        }
+
+        atomic_store(&owners[idx], 0);
+        pkt_pool_free(&pool, idx);
+        atomic_fetch_add(&consumed, 1);
+    }
+    return NULL;
+}
+
+
+// Nothing but alloc/free pairs, so the pool's own cost under contention
+// shows without the hand-over and the copying around it
+static void *bench_pairs(void *arg) {
+    (void)arg;
+
+    for (uint32_t n = 0; n < BENCH_PAIRS; n++) {
+        uint8_t idx = pkt_pool_alloc(&pool);
+
+        if (idx != PKT_POOL_INVALID) pkt_pool_free(&pool, idx);
+        if (n % BENCH_YIELD_EVERY == 0) sched_yield();
+    }
+    return NULL;
+}
+
+
+TEST_GROUP(pkt_pool);
+
+TEST_SETUP(pkt_pool) {
+    pkt_pool_init(&pool);
+}
+
+TEST_TEAR_DOWN(pkt_pool) {
+}
+
+
+TEST(pkt_pool, alloc_until_exhausted) {
+    pkt_pool_stats_t stats;
+    uint32_t seen = 0;
+
+    for (int i = 0; i < PKT_POOL_SLOTS; i++) {
+        uint8_t idx = pkt_pool_alloc(&pool);
+        TEST_ASSERT_LESS_THAN(PKT_POOL_SLOTS, idx);
+        TEST_ASSERT_FALSE(seen & (1u << idx));
+        seen |= 1u << idx;
+    }
+    TEST_ASSERT_EQUAL_HEX8(PKT_POOL_INVALID, pkt_pool_alloc(&pool));
+
+    pkt_pool_get_stats(&pool, &stats);
+    TEST_ASSERT_EQUAL_UINT32(PKT_POOL_SLOTS, stats.in_use);
+    TEST_ASSERT_EQUAL_UINT32(PKT_POOL_SLOTS, stats.in_use_hwm);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.exhausted);
+}
+
+
+TEST(pkt_pool, freed_slot_is_reused) {
+    pkt_pool_stats_t stats;
+    uint8_t a = pkt_pool_alloc(&pool);
+    uint8_t b = pkt_pool_alloc(&pool);
+
+    pkt_pool_free(&pool, a);
+    TEST_ASSERT_EQUAL_UINT8(a, pkt_pool_alloc(&pool));
+
+    pkt_pool_free(&pool, a);
+    pkt_pool_free(&pool, b);
+    pkt_pool_free(&pool, PKT_POOL_INVALID);
+
+    pkt_pool_get_stats(&pool, &stats);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.in_use);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.in_use_hwm);
+}
+
+
+// Producers claim slots and fill them, consumers check the contents and hand
+// them back. Every slot must come back exactly once, never be held twice and
+// never be written while someone else owns it. Times an alloc/free pair on
+// its own thread first, then with BENCH_THREADS threads on the same pool.
+TEST(pkt_pool, stress_no_leak_no_double_claim) {
+    pthread_t threads[STRESS_PRODUCERS + STRESS_CONSUMERS];
+    pkt_pool_stats_t stats;
+
+    int64_t start = bench_now_ns();
+    for (uint32_t n = 0; n < BENCH_PAIRS; n++) pkt_pool_free(&pool, pkt_pool_alloc(&pool));
+    int64_t single_ns = bench_now_ns() - start;
+
+    start = bench_now_ns();
+    for (int i = 0; i < BENCH_THREADS; i++) pthread_create(&threads[i], NULL, bench_pairs, NULL);
+    for (int i = 0; i < BENCH_THREADS; i++) pthread_join(threads[i], NULL);
+    int64_t shared_ns = bench_now_ns() - start;
+
+    pkt_pool_init(&pool);
+
+    pthread_mutex_init(&handover.lock, NULL);
+    handover.head = handover.count = 0;
+    atomic_store(&producers_left, STRESS_PRODUCERS);
+    atomic_store(&consumed, 0);
+    atomic_store(&double_owned, 0);
+    atomic_store(&corrupted, 0);
+    for (int i = 0; i < PKT_POOL_SLOTS; i++) atomic_store(&owners[i], 0);
+
+    start = bench_now_ns();
+    for (int i = 0; i < STRESS_PRODUCERS; i++) {
+        pthread_create(&threads[i], NULL, producer, (void *)(uintptr_t)i);
+    }
+    for (int i = 0; i < STRESS_CONSUMERS; i++) {
+        pthread_create(&threads[STRESS_PRODUCERS + i], NULL, consumer, NULL);
+    }
+    for (int i = 0; i < STRESS_PRODUCERS + STRESS_CONSUMERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    int64_t stress_ns = bench_now_ns() - start;
+    pthread_mutex_destroy(&handover.lock);
+
+    pkt_pool_get_stats(&pool, &stats);
+    printf("pkt_pool: alloc/free %.1f ns alone, %.1f ns with %d threads; "
+           "stress %u packets at %.0f ns each, hwm %lu, exhausted %lu\n",
+           (double)single_ns / BENCH_PAIRS, (double)shared_ns / ((double)BENCH_PAIRS * BENCH_THREADS), BENCH_THREADS,
+           atomic_load(&consumed), (double)stress_ns / (STRESS_PRODUCERS * STRESS_PER_PRODUCER),
+           (unsigned long)stats.in_use_hwm, (unsigned long)stats.exhausted);
+
+    TEST_ASSERT_EQUAL_UINT32(STRESS_PRODUCERS * STRESS_PER_PRODUCER, atomic_load(&consumed));
+    TEST_ASSERT_EQUAL_UINT32(0, atomic_load(&double_owned));
+    TEST_ASSERT_EQUAL_UINT32(0, atomic_load(&corrupted));
+    TEST_ASSERT_EQUAL_UINT32(0, stats.in_use);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(PKT_POOL_SLOTS, stats.in_use_hwm);
+}
+
+
+TEST_GROUP_RUNNER(pkt_pool) {
+    RUN_TEST_CASE(pkt_pool, alloc_until_exhausted);
+    RUN_TEST_CASE(pkt_pool, freed_slot_is_reused);
+    RUN_TEST_CASE(pkt_pool, stress_no_leak_no_double_claim);
+}
@@ -0,0 +1,181 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+#include "pkt_pool.h"
+#include "recv_ring.h"
+#include "test_bench.h"
+
+#define BURST_FRAMES        64      // frames per burst, well past the ring depth
+#define BURST_COUNT         2000
+#define BURST_GAP_NS        20000   // quiet time between bursts
+#define BURST_FRAME_LEN     200
+#define BURST_RING_DEPTH    8
+#define BURST_BATCH         8
+
+static recv_ring_t ring;
+static pkt_pool_t pool;
+static atomic_bool producer_done;
+static uint32_t consumed;
+static uint32_t out_of_order;
+
+
+TEST_GROUP(recv_ring);
+
+TEST_SETUP(recv_ring) {
+    TEST_ASSERT_TRUE(recv_ring_init(&ring, 4));
+}
+
+TEST_TEAR_DOWN(recv_ring) {
+}
+
+
+TEST(recv_ring, rejects_bad_depth) {
+    recv_ring_t r;
+
+    TEST_ASSERT_FALSE(recv_ring_init(&r, 0));
+    TEST_ASSERT_FALSE(recv_ring_init(&r, 6));
+    TEST_ASSERT_FALSE(recv_ring_init(&r, RECV_RING_MAX_DEPTH * 2));
+    TEST_ASSERT_TRUE(recv_ring_init(&r, RECV_RING_MAX_DEPTH));
+}
+
+
+TEST(recv_ring, fifo_across_wrap) {
+    uint8_t out[4];
+    uint8_t next = 0;
+
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 3; i++) TEST_ASSERT_TRUE(recv_ring_push(&ring, (uint8_t)(round * 3 + i)));
+        TEST_ASSERT_EQUAL_UINT32(3, recv_ring_pop_batch(&ring, out, 4));
+        for (int i = 0; i < 3; i++) TEST_ASSERT_EQUAL_UINT8(next++, out[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, recv_ring_pop_batch(&ring, out, 4));
+}
+
+
+TEST(recv_ring, full_ring_drops_and_counts) {
+    recv_ring_stats_t stats;
+    uint8_t out[2];
+
+    for (int i = 0; i < 4; i++) TEST_ASSERT_TRUE(recv_ring_push(&ring, (uint8_t)i));
+    TEST_ASSERT_FALSE(recv_ring_push(&ring, 4));
+    TEST_ASSERT_FALSE(recv_ring_push(&ring, 5));
+
+    // a batch takes no more than asked for
+    TEST_ASSERT_EQUAL_UINT32(2, recv_ring_pop_batch(&ring, out, 2));
+    TEST_ASSERT_EQUAL_UINT8(0, out[0]);
+    TEST_ASSERT_TRUE(recv_ring_push(&ring, 6));
+
+    recv_ring_get_stats(&ring, &stats);
+    TEST_ASSERT_EQUAL_UINT32(4, stats.depth);
+    TEST_ASSERT_EQUAL_UINT32(4, stats.high_water);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.dropped);
+}
+
+
+// Stands in for the receive task: drains a batch per wake-up, checks that
+// frames come out in the order they went in and returns the slots.
+static void *burst_consumer(void *arg) {
+    uint8_t batch[BURST_BATCH];
+    uint32_t expect = 0;
+
+    (void)arg;
+    for (;;) {
+        uint32_t n = recv_ring_pop_batch(&ring, batch, BURST_BATCH);
+
+        if (n == 0) {
+            if (atomic_load(&producer_done) && recv_ring_pop_batch(&ring, batch, 1) == 0) break;
+            sched_yield();
+            continue;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            esp_now_data_packet_buff_t *pkt = pkt_pool_slot(&pool, batch[i]);
+            uint32_t seq;
+
+            memcpy(&seq, pkt->data, sizeof(seq));
+            if (seq < expect) out_of_order++;
+            expect = seq + 1;
+            pkt_pool_free(&pool, batch[i]);
+            consumed++;
+        }
+    }
+    return NULL;
+}
+
+
+// Replays bursts of frames through the same claim/copy/push path as the
+// receive callback and reports what the consumer sustained and how long the
+// callback side took per frame at worst.
+TEST(recv_ring, burst_replay_benchmark) {
+    static const uint8_t src[PKT_POOL_ADDR_LEN] = { 0x02, 0, 0, 0, 0, 0x01 };
+    uint8_t payload[BURST_FRAME_LEN];
+    recv_ring_stats_t ring_stats;
+    pkt_pool_stats_t pool_stats;
+    pthread_t consumer;
+    int64_t worst_ns = 0;
+    int64_t sum_ns = 0;
+    uint32_t offered = 0;
+    uint32_t pool_drops = 0;
+
+    TEST_ASSERT_TRUE(recv_ring_init(&ring, BURST_RING_DEPTH));
+    pkt_pool_init(&pool);
+    atomic_store(&producer_done, false);
+    consumed = out_of_order = 0;
+    memset(payload, 0xA5, sizeof(payload));
+
+    pthread_create(&consumer, NULL, burst_consumer, NULL);
+    int64_t start = bench_now_ns();
+
+    for (uint32_t burst = 0; burst < BURST_COUNT; burst++) {
+        for (uint32_t f = 0; f < BURST_FRAMES; f++, offered++) {
+            int64_t t0 = bench_now_ns();
+            uint8_t idx = pkt_pool_alloc(&pool);
+
+            if (idx == PKT_POOL_INVALID) {
+                pool_drops++;
+            } else {
+                esp_now_data_packet_buff_t *pkt = pkt_pool_slot(&pool, idx);
+                memcpy(pkt->source_addr, src, sizeof(src));
+                memcpy(pkt->data, payload, sizeof(payload));
+                memcpy(pkt->data, &offered, sizeof(offered));
+                pkt->len = sizeof(payload);
+                if (!recv_ring_push(&ring, idx)) pkt_pool_free(&pool, idx);
+            }
+
+            int64_t dt = bench_now_ns() - t0;
+            if (dt > worst_ns) worst_ns = dt;
+            sum_ns += dt;
+        }
+
+        int64_t quiet_until = bench_now_ns() + BURST_GAP_NS;
+        while (bench_now_ns() < quiet_until) sched_yield();
+    }
+
+    atomic_store(&producer_done, true);
+    pthread_join(consumer, NULL);
+    int64_t elapsed = bench_now_ns() - start;
+
+    recv_ring_get_stats(&ring, &ring_stats);
+    pkt_pool_get_stats(&pool, &pool_stats);
+    printf("recv_ring burst replay: offered %lu, delivered %lu (%.0f frames/s), ring drops %lu, pool drops %lu, "
+           "enqueue mean %.0f ns worst %lld ns\n",
+           (unsigned long)offered, (unsigned long)consumed, bench_per_s(consumed, elapsed),
+           (unsigned long)ring_stats.dropped, (unsigned long)pool_drops,
+           (double)sum_ns / offered, (long long)worst_ns);
+
+    TEST_ASSERT_EQUAL_UINT32(0, out_of_order);
+    TEST_ASSERT_EQUAL_UINT32(offered, consumed + ring_stats.dropped + pool_drops);
+    TEST_ASSERT_EQUAL_UINT32(0, pool_stats.in_use);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(BURST_RING_DEPTH, ring_stats.high_water);
+}
+
+
+TEST_GROUP_RUNNER(recv_ring) {
+    RUN_TEST_CASE(recv_ring, rejects_bad_depth);
+    RUN_TEST_CASE(recv_ring, fifo_across_wrap);
+    RUN_TEST_CASE(recv_ring, full_ring_drops_and_counts);
+    RUN_TEST_CASE(recv_ring, burst_replay_benchmark);
+}
@@ -0,0 +1,148 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+#include "telemetry.h"
+#include "test_bench.h"
+
+#define BENCH_INCREMENTS    10000000
+#define BENCH_THREADS       2
+
+
+static void telemetry_reset(void) {
+    memset(telemetry_cores, 0, sizeof(telemetry_cores));
+    memset(telemetry_gauges, 0, sizeof(telemetry_gauges));
+}
+
+
+TEST_GROUP(telemetry);
+
+TEST_SETUP(telemetry) {
+    telemetry_reset();
+}
+
+TEST_TEAR_DOWN(telemetry) {
+}
+
+
+TEST(telemetry, snapshot_sums_cores) {
+    telemetry_snapshot_t snap;
+
+    telemetry_add(TM_TX_RECORDS, 5);
+    telemetry_inc(TM_RX_POOL_EMPTY);
+    // the other core's share, as an increment on core 1 would leave it
+    atomic_store(&telemetry_cores[1].counters[TM_TX_RECORDS], 7);
+    telemetry_gauge_max(TM_GAUGE_POOL_HWM, 3);
+    telemetry_gauge_max(TM_GAUGE_POOL_HWM, 2);
+
+    telemetry_snapshot(&snap, 1234);
+    TEST_ASSERT_EQUAL_UINT8(TELEMETRY_SNAPSHOT_VERSION, snap.version);
+    TEST_ASSERT_EQUAL_UINT32(1234, snap.uptime_ms);
+    TEST_ASSERT_EQUAL_UINT32(12, snap.counters[TM_TX_RECORDS]);
+    TEST_ASSERT_EQUAL_UINT32(1, snap.counters[TM_RX_POOL_EMPTY]);
+    TEST_ASSERT_EQUAL_UINT32(0, snap.counters[TM_RX_DROPPED]);
+    TEST_ASSERT_EQUAL_UINT32(3, snap.gauges[TM_GAUGE_POOL_HWM]);
+}
+
+
+TEST(telemetry, percentile_reports_bucket_bound) {
+    telemetry_snapshot_t snap;
+
+    telemetry_snapshot(&snap, 0);
+    TEST_ASSERT_EQUAL_UINT32(0, telemetry_percentile_us(&snap, TM_HIST_RX_LATENCY, 50));
+
+    for (int i = 0; i < 99; i++) telemetry_record_us(TM_HIST_RX_LATENCY, 10);
+    telemetry_record_us(TM_HIST_RX_LATENCY, 5000);
+    telemetry_snapshot(&snap, 0);
+    TEST_ASSERT_EQUAL_UINT32(16, telemetry_percentile_us(&snap, TM_HIST_RX_LATENCY, 50));
+    TEST_ASSERT_EQUAL_UINT32(16, telemetry_percentile_us(&snap, TM_HIST_RX_LATENCY, 99));
+    TEST_ASSERT_EQUAL_UINT32(8192, telemetry_percentile_us(&snap, TM_HIST_RX_LATENCY, 100));
+
+    // anything past the last bucket lands in it
+    TEST_ASSERT_EQUAL_UINT32(TELEMETRY_HIST_BUCKETS - 1, telemetry_hist_bucket(UINT32_MAX));
+    TEST_ASSERT_EQUAL_UINT32(0, telemetry_hist_bucket(0));
+}
+
+
+// A short buffer still gets a terminated prefix and the full length back
+TEST(telemetry, format_reports_full_length) {
+    telemetry_snapshot_t snap;
+    char full[1024];
+    char part[16];
+
+    telemetry_inc(TM_RX_POOL_EMPTY);
+    telemetry_snapshot(&snap, 42);
+
+    int len = telemetry_format(&snap, full, sizeof(full));
+    TEST_ASSERT_GREATER_THAN(0, len);
+    TEST_ASSERT_LESS_THAN((int)sizeof(full), len);
+    TEST_ASSERT_EQUAL_INT(len, (int)strlen(full));
+    TEST_ASSERT_NOT_NULL(strstr(full, " rx_drop=0 rx_pool_empty=1 rx_oversize=0 "));
+
+    TEST_ASSERT_EQUAL_INT(len, telemetry_format(&snap, part, sizeof(part)));
+    TEST_ASSERT_EQUAL_INT(sizeof(part) - 1, strlen(part));
+    TEST_ASSERT_EQUAL_INT(0, strncmp(full, part, sizeof(part) - 1));
+}
+
+
+static void *bench_incrementer(void *arg) {
+    (void)arg;
+    for (uint32_t i = 0; i < BENCH_INCREMENTS; i++) telemetry_inc(TM_RX_FRAMES);
+    return NULL;
+}
+
+
+// Times the calls the hot paths make: a counter increment, a histogram
+// sample and a gauge maximum, against a plain increment as the floor. The
+// threaded run has every thread on the same host "core", so the counters
+// share one cache line: the worst case the per-core split avoids on target.
+TEST(telemetry, increment_benchmark) {
+    static volatile uint32_t plain;
+    pthread_t threads[BENCH_THREADS];
+    telemetry_snapshot_t snap;
+
+    int64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_INCREMENTS; i++) plain++;
+    int64_t plain_ns = bench_now_ns() - start;
+
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_INCREMENTS; i++) telemetry_inc(TM_TX_RECORDS);
+    int64_t inc_ns = bench_now_ns() - start;
+
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_INCREMENTS; i++) telemetry_record_us(TM_HIST_RX_LATENCY, i & 0xFFFF);
+    int64_t hist_ns = bench_now_ns() - start;
+
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_INCREMENTS; i++) telemetry_gauge_max(TM_GAUGE_RING_HWM, i & 0xFF);
+    int64_t gauge_ns = bench_now_ns() - start;
+
+    start = bench_now_ns();
+    for (int t = 0; t < BENCH_THREADS; t++) pthread_create(&threads[t], NULL, bench_incrementer, NULL);
+    for (int t = 0; t < BENCH_THREADS; t++) pthread_join(threads[t], NULL);
+    int64_t shared_ns = bench_now_ns() - start;
+
+    int64_t snap_start = bench_now_ns();
+    telemetry_snapshot(&snap, 0);
+    int64_t snap_ns = bench_now_ns() - snap_start;
+
+    printf("telemetry: plain %.2f ns, inc %.2f ns, hist %.2f ns, gauge_max %.2f ns, "
+           "inc with %d threads %.2f ns, snapshot %lld ns\n",
+           (double)plain_ns / BENCH_INCREMENTS, (double)inc_ns / BENCH_INCREMENTS,
+           (double)hist_ns / BENCH_INCREMENTS, (double)gauge_ns / BENCH_INCREMENTS,
+           BENCH_THREADS, (double)shared_ns / ((double)BENCH_INCREMENTS * BENCH_THREADS), (long long)snap_ns);
+
+    TEST_ASSERT_EQUAL_UINT32(BENCH_INCREMENTS, snap.counters[TM_TX_RECORDS]);
+    TEST_ASSERT_EQUAL_UINT32(BENCH_INCREMENTS * BENCH_THREADS, snap.counters[TM_RX_FRAMES]);
+    TEST_ASSERT_EQUAL_UINT32(0xFF, snap.gauges[TM_GAUGE_RING_HWM]);
+}
+
+
+TEST_GROUP_RUNNER(telemetry) {
+    RUN_TEST_CASE(telemetry, snapshot_sums_cores);
+    RUN_TEST_CASE(telemetry, percentile_reports_bucket_bound);
+    RUN_TEST_CASE(telemetry, format_reports_full_length);
+    RUN_TEST_CASE(telemetry, increment_benchmark);
+}
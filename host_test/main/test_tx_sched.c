@@ -0,0 +1,421 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+#include "tx_sched.h"
+
+#define SIM_MAX_PENDING     TX_SCHED_SLOTS
+
+// Radio stand-in: every frame handed to it is reported on after latency_us,
+// lost with loss_permille, or never reported with silent_permille.
+typedef struct {
+    uint32_t loss_permille;
+    uint32_t silent_permille;
+    uint32_t latency_us;
+    uint32_t seed;
+    struct {
+        uint64_t at_us;
+        uint8_t dest[TX_SCHED_ADDR_LEN];
+        bool success;
+    } pending[SIM_MAX_PENDING];
+    uint32_t n_pending;
+} sim_radio_t;
+
+static const uint8_t peer_a[TX_SCHED_ADDR_LEN] = { 0x02, 0, 0, 0, 0, 0x0A };
+static const uint8_t peer_b[TX_SCHED_ADDR_LEN] = { 0x02, 0, 0, 0, 0, 0x0B };
+static const uint8_t payload[32];
+
+static tx_sched_t sched;
+static tx_sched_config_t cfg;
+
+
+static uint32_t sim_rand_permille(sim_radio_t *radio) {
+    radio->seed = radio->seed * 1103515245u + 12345u;
+    return (radio->seed >> 16) % 1000;
+}
+
+
+static void sim_transmit(sim_radio_t *radio, const tx_frame_t *f, uint64_t now_us) {
+    if (sim_rand_permille(radio) < radio->silent_permille) return;
+
+    TEST_ASSERT_LESS_THAN(SIM_MAX_PENDING, radio->n_pending);
+    radio->pending[radio->n_pending].at_us = now_us + radio->latency_us;
+    memcpy(radio->pending[radio->n_pending].dest, f->dest, TX_SCHED_ADDR_LEN);
+    radio->pending[radio->n_pending].success = sim_rand_permille(radio) >= radio->loss_permille;
+    radio->n_pending++;
+}
+
+
+// Delivers the earliest report due by now_us. Returns false if none is.
+static bool sim_report(sim_radio_t *radio, uint64_t now_us) {
+    uint32_t first = 0;
+
+    if (radio->n_pending == 0) return false;
+    for (uint32_t i = 1; i < radio->n_pending; i++) {
+        if (radio->pending[i].at_us < radio->pending[first].at_us) first = i;
+    }
+    if (radio->pending[first].at_us > now_us) return false;
+
+    tx_sched_on_status(&sched, radio->pending[first].dest, radio->pending[first].success, now_us);
+    radio->pending[first] = radio->pending[--radio->n_pending];
+    return true;
+}
+
+
+static uint64_t sim_next_report_us(const sim_radio_t *radio) {
+    uint64_t t = UINT64_MAX;
+
+    for (uint32_t i = 0; i < radio->n_pending; i++) {
+        if (radio->pending[i].at_us < t) t = radio->pending[i].at_us;
+    }
+    return t;
+}
+
+
+// Runs the send task's loop until every submitted frame is retired or
+// limit_us passes, topping the scheduler up to keep `backlog` frames queued
+// until `frames` were submitted. Returns the simulated time taken.
+static uint64_t sim_run(sim_radio_t *radio, uint32_t frames, uint32_t backlog, uint64_t limit_us) {
+    uint64_t now = 0;
+    uint32_t submitted = 0;
+    tx_sched_stats_t stats;
+
+    for (;;) {
+        uint32_t wait_us;
+        tx_frame_t *f;
+
+        while (sim_report(radio, now)) {
+        }
+        while (submitted < frames && TX_SCHED_SLOTS - tx_sched_free_slots(&sched) < backlog) {
+            TEST_ASSERT_TRUE(tx_sched_submit(&sched, (submitted & 1) ? peer_b : peer_a, payload, sizeof(payload), now, now));
+            submitted++;
+        }
+        while ((f = tx_sched_next(&sched, now, &wait_us)) != NULL) {
+            sim_transmit(radio, f, now);
+        }
+
+        tx_sched_get_stats(&sched, &stats);
+        if (submitted == frames && stats.delivered + stats.dropped == frames) return now;
+        if (now >= limit_us) return now;
+
+        uint64_t next = sim_next_report_us(radio);
+        if (wait_us != TX_SCHED_NO_WAIT && now + wait_us < next) next = now + wait_us;
+        TEST_ASSERT_TRUE_MESSAGE(next != UINT64_MAX, "scheduler stalled");
+        now = next > now ? next : now + 1;
+    }
+}
+
+
+TEST_GROUP(tx_sched);
+
+TEST_SETUP(tx_sched) {
+    cfg = (tx_sched_config_t) {
+        .max_window = 4,
+        .max_retries = 3,
+        .backoff_us = 20000,
+        .min_gap_us = 2000,
+        .max_gap_us = 500000,
+        .ack_timeout_us = 0,
+    };
+    tx_sched_init(&sched, &cfg);
+}
+
+TEST_TEAR_DOWN(tx_sched) {
+}
+
+
+TEST(tx_sched, window_limits_in_flight) {
+    uint32_t wait_us;
+
+    for (int i = 0; i < 6; i++) TEST_ASSERT_TRUE(tx_sched_submit(&sched, peer_a, payload, sizeof(payload), 0, 0));
+
+    // the window starts at one frame
+    TEST_ASSERT_NOT_NULL(tx_sched_next(&sched, 0, &wait_us));
+    TEST_ASSERT_NULL(tx_sched_next(&sched, 1000000, &wait_us));
+    TEST_ASSERT_EQUAL_UINT32(TX_SCHED_NO_WAIT, wait_us);
+
+    // a report frees it again, and one success is a full window
+    tx_sched_on_status(&sched, peer_a, true, 1000000);
+    TEST_ASSERT_NOT_NULL(tx_sched_next(&sched, 1000000, &wait_us));
+    TEST_ASSERT_NOT_NULL(tx_sched_next(&sched, 2000000, &wait_us));
+    TEST_ASSERT_NULL(tx_sched_next(&sched, 3000000, &wait_us));
+}
+
+
+TEST(tx_sched, submit_rejects_when_full) {
+    tx_sched_stats_t stats;
+
+    for (int i = 0; i < TX_SCHED_SLOTS; i++) TEST_ASSERT_TRUE(tx_sched_submit(&sched, peer_a, payload, sizeof(payload), 0, 0));
+    TEST_ASSERT_FALSE(tx_sched_submit(&sched, peer_a, payload, sizeof(payload), 0, 0));
+    TEST_ASSERT_FALSE(tx_sched_submit(&sched, peer_a, payload, TX_SCHED_MTU + 1, 0, 0));
+    TEST_ASSERT_EQUAL_UINT32(0, tx_sched_free_slots(&sched));
+
+    tx_sched_get_stats(&sched, &stats);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.rejected);
+}
+
+
+// Reports retire the oldest frame in flight for their address
+TEST(tx_sched, report_retires_oldest_for_address) {
+    uint32_t wait_us;
+    tx_sched_stats_t stats;
+
+    cfg.min_gap_us = 0;
+    cfg.max_gap_us = 0;
+    tx_sched_init(&sched, &cfg);
+
+    // one success opens the window to two
+    tx_sched_submit(&sched, peer_b, payload, sizeof(payload), 0, 0);
+    TEST_ASSERT_NOT_NULL(tx_sched_next(&sched, 0, &wait_us));
+    TEST_ASSERT_TRUE(tx_sched_on_status(&sched, peer_b, true, 5) == 0);
+
+    tx_sched_submit(&sched, peer_a, payload, sizeof(payload), 5, 5);
+    tx_sched_submit(&sched, peer_a, payload, sizeof(payload), 5, 5);
+    TEST_ASSERT_NOT_NULL(tx_sched_next(&sched, 10, &wait_us));
+    TEST_ASSERT_NOT_NULL(tx_sched_next(&sched, 20, &wait_us));
+
+    TEST_ASSERT_TRUE(tx_sched_on_status(&sched, peer_b, true, 30) == 0);
+    TEST_ASSERT_TRUE(tx_sched_on_status(&sched, peer_a, true, 40) == 10);
+    TEST_ASSERT_TRUE(tx_sched_on_status(&sched, peer_a, true, 50) == 20);
+
+    tx_sched_get_stats(&sched, &stats);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.delivered);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.unmatched);
+    TEST_ASSERT_EQUAL_UINT8(0, stats.in_flight);
+}
+
+
+// Retries wait backoff_us, doubled per attempt, and a frame is dropped once
+// it ran out of retries
+TEST(tx_sched, backoff_doubles_until_dropped) {
+    tx_sched_stats_t stats;
+    uint32_t wait_us;
+    uint64_t now = 0;
+    tx_frame_t *f;
+
+    cfg.min_gap_us = 0;
+    cfg.max_gap_us = 0;
+    tx_sched_init(&sched, &cfg);
+    tx_sched_submit(&sched, peer_a, payload, sizeof(payload), now, now);
+
+    for (uint32_t attempt = 1; attempt <= cfg.max_retries + 1u; attempt++) {
+        f = tx_sched_next(&sched, now, &wait_us);
+        TEST_ASSERT_NOT_NULL(f);
+        TEST_ASSERT_EQUAL_UINT8(attempt, f->attempts);
+        tx_sched_on_status(&sched, peer_a, false, now);
+
+        if (attempt <= cfg.max_retries) {
+            TEST_ASSERT_NULL(tx_sched_next(&sched, now, &wait_us));
+            TEST_ASSERT_EQUAL_UINT32(cfg.backoff_us << (attempt - 1), wait_us);
+            now += wait_us;
+        }
+    }
+
+    tx_sched_get_stats(&sched, &stats);
+    TEST_ASSERT_EQUAL_UINT32(cfg.max_retries + 1u, stats.failed);
+    TEST_ASSERT_EQUAL_UINT32(cfg.max_retries, stats.retried);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.dropped);
+    TEST_ASSERT_EQUAL_UINT32(TX_SCHED_SLOTS, tx_sched_free_slots(&sched));
+}
+
+
+// A frame the radio refused takes the failure path as well
+TEST(tx_sched, refused_send_is_retried) {
+    tx_sched_stats_t stats;
+    uint32_t wait_us;
+
+    tx_sched_submit(&sched, peer_a, payload, sizeof(payload), 0, 0);
+    tx_sched_send_failed(&sched, tx_sched_next(&sched, 0, &wait_us), 0);
+
+    tx_sched_get_stats(&sched, &stats);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.retried);
+    TEST_ASSERT_EQUAL_UINT8(0, stats.in_flight);
+    TEST_ASSERT_EQUAL_UINT32(TX_SCHED_SLOTS - 1, tx_sched_free_slots(&sched));
+}
+
+
+// A frame without a report is counted as failed once the ack timeout ran
+// out, and a report arriving after that no longer matches anything
+TEST(tx_sched, ack_timeout_retires_silent_frame) {
+    tx_sched_stats_t stats;
+    uint32_t wait_us;
+
+    cfg.ack_timeout_us = 100000;
+    tx_sched_init(&sched, &cfg);
+    tx_sched_submit(&sched, peer_a, payload, sizeof(payload), 0, 0);
+    TEST_ASSERT_NOT_NULL(tx_sched_next(&sched, 0, &wait_us));
+
+    TEST_ASSERT_NULL(tx_sched_next(&sched, 1000, &wait_us));
+    TEST_ASSERT_EQUAL_UINT32(cfg.ack_timeout_us - 1000, wait_us);
+
+    TEST_ASSERT_NULL(tx_sched_next(&sched, cfg.ack_timeout_us, &wait_us));
+    tx_sched_get_stats(&sched, &stats);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.timeouts);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.retried);
+    TEST_ASSERT_EQUAL_UINT8(0, stats.in_flight);
+
+    tx_sched_on_status(&sched, peer_a, true, cfg.ack_timeout_us + 1);
+    tx_sched_get_stats(&sched, &stats);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.unmatched);
+}
+
+
+// On a clear channel the window opens to its limit and the gap closes to
+// its floor; every frame is delivered first time
+TEST(tx_sched, clear_channel_opens_up) {
+    sim_radio_t radio = { .latency_us = 1000, .seed = 1 };
+    tx_sched_stats_t stats;
+
+    sim_run(&radio, 400, 8, 60000000);
+
+    tx_sched_get_stats(&sched, &stats);
+    TEST_ASSERT_EQUAL_UINT32(400, stats.delivered);
+    TEST_ASSERT_EQUAL_UINT32(400, stats.sent);
+    TEST_ASSERT_EQUAL_UINT8(cfg.max_window, stats.window);
+    TEST_ASSERT_EQUAL_UINT32(cfg.min_gap_us, stats.gap_us);
+}
+
+
+// A failure pulls the window and gap back to what the success average
+// allows: the window scaled by it, the gap by its inverse square
+TEST(tx_sched, failure_backs_off) {
+    sim_radio_t radio = { .latency_us = 1000, .seed = 1 };
+    tx_sched_stats_t before;
+    tx_sched_stats_t after;
+    uint32_t wait_us;
+    uint64_t now;
+
+    now = sim_run(&radio, 100, 8, 60000000);
+    tx_sched_get_stats(&sched, &before);
+    TEST_ASSERT_EQUAL_UINT8(4, before.window);
+
+    now += cfg.min_gap_us;
+    tx_sched_submit(&sched, peer_a, payload, sizeof(payload), now, now);
+    TEST_ASSERT_NOT_NULL(tx_sched_next(&sched, now, &wait_us));
+    tx_sched_on_status(&sched, peer_a, false, now + 1000);
+
+    tx_sched_get_stats(&sched, &after);
+    TEST_ASSERT_LESS_THAN(before.success_permille, after.success_permille);
+    TEST_ASSERT_EQUAL_UINT8(cfg.max_window * after.success_permille / 1000, after.window);
+    TEST_ASSERT_EQUAL_UINT32(cfg.min_gap_us * 1000000ull / ((uint32_t)after.success_permille * after.success_permille),
+                             after.gap_us);
+    TEST_ASSERT_GREATER_THAN(before.gap_us, after.gap_us);
+}
+
+
+// Frames whose reports never come still all end up delivered or dropped
+TEST(tx_sched, silent_radio_recovers_through_timeouts) {
+    sim_radio_t radio = { .latency_us = 2000, .silent_permille = 100, .seed = 7 };
+    tx_sched_stats_t stats;
+
+    cfg.ack_timeout_us = 50000;
+    tx_sched_init(&sched, &cfg);
+    sim_run(&radio, 300, 8, 600000000);
+
+    tx_sched_get_stats(&sched, &stats);
+    TEST_ASSERT_EQUAL_UINT32(300, stats.delivered + stats.dropped);
+    TEST_ASSERT_GREATER_THAN(0, stats.timeouts);
+    TEST_ASSERT_EQUAL_UINT8(0, stats.in_flight);
+}
+
+
+// Runs the same load at increasing loss and reports how the scheduler
+// settled. Loss must shrink the window, stretch the gap and cost throughput,
+// but moderate loss must not cost more than what retrying it takes.
+TEST(tx_sched, adapts_to_loss) {
+    static const uint32_t loss[] = { 0, 100, 300, 500 };
+    uint32_t last_gap = 0;
+    double clear_fps = 0;
+
+    for (size_t i = 0; i < sizeof(loss) / sizeof(loss[0]); i++) {
+        sim_radio_t radio = { .latency_us = 2000, .loss_permille = loss[i], .seed = 3 };
+        tx_sched_stats_t stats;
+
+        tx_sched_init(&sched, &cfg);
+        uint64_t took = sim_run(&radio, 2000, 8, 3600000000ull);
+        tx_sched_get_stats(&sched, &stats);
+        double fps = took ? stats.delivered * 1e6 / took : 0.0;
+
+        printf("tx_sched loss %3lu%%: %lu delivered %lu dropped in %.1f s (%.0f frames/s), sent %lu, "
+               "window %u, gap %lu us, success %u permille\n",
+               (unsigned long)loss[i] / 10, (unsigned long)stats.delivered, (unsigned long)stats.dropped,
+               took / 1e6, fps, (unsigned long)stats.sent,
+               stats.window, (unsigned long)stats.gap_us, stats.success_permille);
+
+        TEST_ASSERT_EQUAL_UINT32(2000, stats.delivered + stats.dropped);
+        TEST_ASSERT_UINT32_WITHIN(150, 1000 - loss[i], stats.success_permille);
+        if (loss[i] == 0) {
+            TEST_ASSERT_EQUAL_UINT32(0, stats.dropped);
+            clear_fps = fps;
+        } else {
+            // up to 30 % loss keeps at least a quarter of the clear channel's rate
+            if (loss[i] <= 300) TEST_ASSERT_TRUE(fps >= clear_fps / 4);
+            TEST_ASSERT_GREATER_OR_EQUAL_UINT32(last_gap, stats.gap_us);
+            TEST_ASSERT_GREATER_THAN(0, stats.retried);
+        }
+        last_gap = stats.gap_us;
+    }
+}
+
+
+// A peer that keeps failing while another is delivered to only costs the
+// channel its first failures; the window and gap stay with the good peer
+TEST(tx_sched, failing_peer_does_not_shrink_shared_window) {
+    tx_sched_stats_t stats;
+    uint32_t wait_us;
+    uint64_t now = 0;
+    tx_frame_t *f;
+
+    cfg.max_retries = 0;
+    tx_sched_init(&sched, &cfg);
+
+    for (int i = 0; i < 200 || tx_sched_free_slots(&sched) < TX_SCHED_SLOTS; i++) {
+        if (i < 200) tx_sched_submit(&sched, (i & 1) ? peer_b : peer_a, payload, sizeof(payload), now, now);
+        while ((f = tx_sched_next(&sched, now, &wait_us)) != NULL) {
+            tx_sched_on_status(&sched, f->dest, memcmp(f->dest, peer_a, TX_SCHED_ADDR_LEN) != 0, now);
+        }
+        now += wait_us == TX_SCHED_NO_WAIT ? cfg.min_gap_us : wait_us;
+    }
+
+    tx_sched_get_stats(&sched, &stats);
+    TEST_ASSERT_EQUAL_UINT32(100, stats.delivered);
+    TEST_ASSERT_EQUAL_UINT32(100, stats.dropped);
+    TEST_ASSERT_EQUAL_UINT32(100 - TX_SCHED_DEST_FAILURES, stats.isolated);
+    TEST_ASSERT_EQUAL_UINT8(cfg.max_window, stats.window);
+    TEST_ASSERT_EQUAL_UINT32(cfg.min_gap_us, stats.gap_us);
+}
+
+
+// When nothing gets through, every failure still counts against the channel
+TEST(tx_sched, all_peers_failing_still_backs_off) {
+    sim_radio_t radio = { .latency_us = 1000, .loss_permille = 1000, .seed = 1 };
+    tx_sched_stats_t stats;
+
+    cfg.max_retries = 0;
+    tx_sched_init(&sched, &cfg);
+    sim_run(&radio, 40, 8, 600000000);
+
+    tx_sched_get_stats(&sched, &stats);
+    TEST_ASSERT_EQUAL_UINT32(40, stats.dropped);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.isolated);
+    TEST_ASSERT_EQUAL_UINT8(1, stats.window);
+    TEST_ASSERT_EQUAL_UINT32(cfg.max_gap_us, stats.gap_us);
+}
+
+
+TEST_GROUP_RUNNER(tx_sched) {
+    RUN_TEST_CASE(tx_sched, window_limits_in_flight);
+    RUN_TEST_CASE(tx_sched, submit_rejects_when_full);
+    RUN_TEST_CASE(tx_sched, report_retires_oldest_for_address);
+    RUN_TEST_CASE(tx_sched, backoff_doubles_until_dropped);
+    RUN_TEST_CASE(tx_sched, refused_send_is_retried);
+    RUN_TEST_CASE(tx_sched, ack_timeout_retires_silent_frame);
+    RUN_TEST_CASE(tx_sched, clear_channel_opens_up);
+    RUN_TEST_CASE(tx_sched, failure_backs_off);
+    RUN_TEST_CASE(tx_sched, silent_radio_recovers_through_timeouts);
+    RUN_TEST_CASE(tx_sched, adapts_to_loss);
+    RUN_TEST_CASE(tx_sched, failing_peer_does_not_shrink_shared_window);
+    RUN_TEST_CASE(tx_sched, all_peers_failing_still_backs_off);
+}
@@ -0,0 +1,264 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+#include "value_cache.h"
+#include "test_bench.h"
+
+#define EPOCH_A             0x1111
+#define EPOCH_B             0x2222
+#define BENCH_PEERS         8
+#define BENCH_TAGS          8
+#define BENCH_WRITES        2000000
+#define BENCH_READERS       2
+#define BENCH_YIELD_EVERY   4096    // one CPU is enough to interleave the threads
+
+static value_cache_t cache;
+static atomic_bool writer_done;
+static uint64_t reads[BENCH_READERS];
+static uint64_t torn[BENCH_READERS];
+
+
+static void put(uint8_t peer, uint8_t tag, uint32_t value, uint16_t frame_seq, uint32_t now_ms) {
+    frame_record_t rec = { .tag = tag, .len = 2, .value = value };
+
+    TEST_ASSERT_TRUE(value_cache_put(&cache, peer, &rec, frame_seq, now_ms));
+}
+
+
+// Feeds a frame header and returns whether it was accepted
+static bool frame(uint8_t peer, uint16_t epoch, uint16_t seq) {
+    uint32_t missed;
+
+    return value_cache_begin_frame(&cache, peer, epoch, seq, &missed);
+}
+
+
+TEST_GROUP(value_cache);
+
+TEST_SETUP(value_cache) {
+    value_cache_init(&cache);
+}
+
+TEST_TEAR_DOWN(value_cache) {
+}
+
+
+TEST(value_cache, put_and_get) {
+    value_cache_value_t v;
+
+    TEST_ASSERT_FALSE(value_cache_get(&cache, 0, 0x0D, &v));
+    put(0, 0x0D, 55, 7, 1000);
+    put(3, 0x0D, 66, 8, 1001);
+
+    TEST_ASSERT_TRUE(value_cache_get(&cache, 0, 0x0D, &v));
+    TEST_ASSERT_EQUAL_UINT32(55, v.value);
+    TEST_ASSERT_EQUAL_UINT32(1000, v.time_ms);
+    TEST_ASSERT_EQUAL_UINT16(7, v.frame_seq);
+    TEST_ASSERT_EQUAL_UINT8(2, v.len);
+    TEST_ASSERT_TRUE(value_cache_get(&cache, 3, 0x0D, &v));
+    TEST_ASSERT_EQUAL_UINT32(66, v.value);
+
+    // same column, other peers have nothing yet
+    TEST_ASSERT_FALSE(value_cache_get(&cache, 1, 0x0D, &v));
+    TEST_ASSERT_FALSE(value_cache_get(&cache, VALUE_CACHE_PEERS, 0x0D, &v));
+
+    value_cache_reset_peer(&cache, 0);
+    TEST_ASSERT_FALSE(value_cache_get(&cache, 0, 0x0D, &v));
+    TEST_ASSERT_TRUE(value_cache_get(&cache, 3, 0x0D, &v));
+}
+
+
+TEST(value_cache, columns_run_out) {
+    frame_record_t rec = { .len = 1 };
+
+    for (uint32_t tag = 0; tag < VALUE_CACHE_TAGS; tag++) {
+        rec.tag = (uint8_t)tag;
+        TEST_ASSERT_TRUE(value_cache_put(&cache, 0, &rec, 0, 0));
+    }
+    rec.tag = VALUE_CACHE_TAGS;
+    TEST_ASSERT_FALSE(value_cache_put(&cache, 0, &rec, 0, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, atomic_load(&cache.no_column));
+}
+
+
+TEST(value_cache, counts_gaps_and_duplicates) {
+    value_cache_peer_stats_t stats;
+    uint32_t missed;
+
+    TEST_ASSERT_TRUE(frame(0, EPOCH_A, 10));
+    TEST_ASSERT_TRUE(value_cache_begin_frame(&cache, 0, EPOCH_A, 14, &missed));
+    TEST_ASSERT_EQUAL_UINT32(3, missed);
+
+    // a repeat and a late frame are both left out
+    TEST_ASSERT_FALSE(frame(0, EPOCH_A, 14));
+    TEST_ASSERT_FALSE(frame(0, EPOCH_A, 12));
+
+    // the sequence wraps without a gap
+    TEST_ASSERT_TRUE(frame(1, EPOCH_A, 0xFFFF));
+    TEST_ASSERT_TRUE(value_cache_begin_frame(&cache, 1, EPOCH_A, 0, &missed));
+    TEST_ASSERT_EQUAL_UINT32(0, missed);
+
+    value_cache_get_peer_stats(&cache, 0, &stats);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.frames);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.gaps);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.duplicates);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.restarts);
+}
+
+
+// A sender that rebooted late in its sequence starts again at 0, which
+// looks like a jump forward; it must not be booked as missed frames.
+TEST(value_cache, restart_from_high_sequence) {
+    value_cache_peer_stats_t stats;
+    uint32_t missed;
+
+    TEST_ASSERT_TRUE(frame(0, EPOCH_A, 40000));
+    TEST_ASSERT_TRUE(value_cache_begin_frame(&cache, 0, EPOCH_B, 0, &missed));
+    TEST_ASSERT_EQUAL_UINT32(0, missed);
+    TEST_ASSERT_TRUE(frame(0, EPOCH_B, 1));
+
+    value_cache_get_peer_stats(&cache, 0, &stats);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.gaps);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.restarts);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.frames);
+}
+
+
+// A sender that rebooted early in its sequence starts again below where it
+// was, which looks like repeats; its frames must still be applied.
+TEST(value_cache, restart_from_low_sequence) {
+    value_cache_peer_stats_t stats;
+    value_cache_value_t v;
+
+    for (uint16_t seq = 0; seq < 10; seq++) TEST_ASSERT_TRUE(frame(0, EPOCH_A, seq));
+    put(0, 0x0D, 1, 9, 100);
+
+    TEST_ASSERT_TRUE(frame(0, EPOCH_B, 0));
+    put(0, 0x0D, 2, 0, 200);
+    TEST_ASSERT_TRUE(frame(0, EPOCH_B, 1));
+
+    value_cache_get_peer_stats(&cache, 0, &stats);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.duplicates);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.gaps);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.restarts);
+    TEST_ASSERT_TRUE(value_cache_get(&cache, 0, 0x0D, &v));
+    TEST_ASSERT_EQUAL_UINT32(2, v.value);
+}
+
+
+// Should a reboot draw the same epoch, a long jump back still reads as one
+TEST(value_cache, restart_with_same_epoch) {
+    value_cache_peer_stats_t stats;
+
+    TEST_ASSERT_TRUE(frame(0, EPOCH_A, 1000));
+    TEST_ASSERT_FALSE(frame(0, EPOCH_A, 1000 - VALUE_CACHE_REORDER_WINDOW + 1));
+    TEST_ASSERT_TRUE(frame(0, EPOCH_A, 5));
+
+    value_cache_get_peer_stats(&cache, 0, &stats);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.restarts);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.duplicates);
+}
+
+
+// Stands in for the receive task: writes every entry over and over with a
+// value its time and frame sequence can be checked against
+static void *bench_writer(void *arg) {
+    frame_record_t rec = { .len = 4 };
+
+    (void)arg;
+    for (uint32_t i = 0; i < BENCH_WRITES; i++) {
+        rec.tag = (uint8_t)(i % BENCH_TAGS);
+        rec.value = i;
+        value_cache_put(&cache, (uint8_t)(i / BENCH_TAGS % BENCH_PEERS), &rec, (uint16_t)i, ~i);
+        if (i % BENCH_YIELD_EVERY == 0) sched_yield();
+    }
+    atomic_store(&writer_done, true);
+    return NULL;
+}
+
+
+static void *bench_reader(void *arg) {
+    int id = (int)(intptr_t)arg;
+    value_cache_value_t v;
+    uint32_t i = (uint32_t)id * 7919;
+
+    while (!atomic_load_explicit(&writer_done, memory_order_relaxed)) {
+        i++;
+        if (!value_cache_get(&cache, (uint8_t)(i % BENCH_PEERS), (uint8_t)(i / BENCH_PEERS % BENCH_TAGS), &v)) continue;
+        if (v.time_ms != ~v.value || v.frame_seq != (uint16_t)v.value) torn[id]++;
+        if (++reads[id] % BENCH_YIELD_EVERY == 0) sched_yield();
+    }
+    return NULL;
+}
+
+
+// Times puts and gets on their own, then runs the writer against readers
+// hammering the same entries and checks that no reader ever copied a
+// half-written entry.
+TEST(value_cache, contention_benchmark) {
+    pthread_t writer;
+    pthread_t readers[BENCH_READERS];
+    frame_record_t rec = { .tag = 0, .len = 4 };
+    value_cache_value_t v;
+    uint64_t total_reads = 0;
+    uint64_t total_torn = 0;
+
+    for (uint8_t tag = 0; tag < BENCH_TAGS; tag++) {
+        rec.tag = tag;
+        for (uint8_t peer = 0; peer < BENCH_PEERS; peer++) value_cache_put(&cache, peer, &rec, 0, ~0u);
+    }
+
+    int64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_WRITES; i++) {
+        rec.tag = (uint8_t)(i % BENCH_TAGS);
+        value_cache_put(&cache, (uint8_t)(i / BENCH_TAGS % BENCH_PEERS), &rec, 0, ~0u);
+    }
+    int64_t put_ns = bench_now_ns() - start;
+
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_WRITES; i++) {
+        value_cache_get(&cache, (uint8_t)(i % BENCH_PEERS), (uint8_t)(i / BENCH_PEERS % BENCH_TAGS), &v);
+    }
+    int64_t get_ns = bench_now_ns() - start;
+
+    atomic_store(&writer_done, false);
+    memset(reads, 0, sizeof(reads));
+    memset(torn, 0, sizeof(torn));
+
+    start = bench_now_ns();
+    for (int r = 0; r < BENCH_READERS; r++) pthread_create(&readers[r], NULL, bench_reader, (void *)(intptr_t)r);
+    pthread_create(&writer, NULL, bench_writer, NULL);
+    pthread_join(writer, NULL);
+    for (int r = 0; r < BENCH_READERS; r++) pthread_join(readers[r], NULL);
+    int64_t shared_ns = bench_now_ns() - start;
+
+    for (int r = 0; r < BENCH_READERS; r++) {
+        total_reads += reads[r];
+        total_torn += torn[r];
+    }
+
+    printf("value_cache: put %.1f ns, get %.1f ns uncontended; with %d readers %.1f Mwrites/s, %.1f Mreads/s, %llu torn\n",
+           (double)put_ns / BENCH_WRITES, (double)get_ns / BENCH_WRITES, BENCH_READERS,
+           bench_per_s(BENCH_WRITES, shared_ns) / 1e6, bench_per_s(total_reads, shared_ns) / 1e6,
+           (unsigned long long)total_torn);
+
+    TEST_ASSERT_TRUE(total_torn == 0);
+    TEST_ASSERT_TRUE(value_cache_get(&cache, (BENCH_WRITES - 1) / BENCH_TAGS % BENCH_PEERS,
+                                     (BENCH_WRITES - 1) % BENCH_TAGS, &v));
+    TEST_ASSERT_EQUAL_UINT32(BENCH_WRITES - 1, v.value);
+}
+
+
+TEST_GROUP_RUNNER(value_cache) {
+    RUN_TEST_CASE(value_cache, put_and_get);
+    RUN_TEST_CASE(value_cache, columns_run_out);
+    RUN_TEST_CASE(value_cache, counts_gaps_and_duplicates);
+    RUN_TEST_CASE(value_cache, restart_from_high_sequence);
+    RUN_TEST_CASE(value_cache, restart_from_low_sequence);
+    RUN_TEST_CASE(value_cache, restart_with_same_epoch);
+    RUN_TEST_CASE(value_cache, contention_benchmark);
+}
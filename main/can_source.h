@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Where the CAN bridge gets its frames from. The on-chip TWAI controller is
+// one implementation; a candump log replay is another, so the bridge can be
+// driven without a bus.
+
+#define CAN_MAX_DLC                 8
+
+typedef struct {
+    uint32_t id;
+    uint8_t dlc;
+    uint8_t data[CAN_MAX_DLC];
+} can_frame_t;
+
+typedef struct can_source can_source_t;
+
+struct can_source {
+    // Waits up to timeout_ms for the next frame. Returns false on timeout.
+    bool (*recv)(can_source_t *src, can_frame_t *frame, uint32_t timeout_ms);
+    // Puts a frame on the bus. Returns false if it could not be queued.
+    bool (*send)(can_source_t *src, const can_frame_t *frame);
+    void *ctx;
+};
+
+// On-chip TWAI controller. Only OBD-II response IDs pass the hardware
+// acceptance filter, and responses for PIDs not listed are dropped in the
+// receive interrupt before they reach a task.
+typedef struct {
+    int tx_gpio;
+    int rx_gpio;
+    uint32_t bitrate;
+    const uint8_t *pids;
+    size_t n_pids;
+} can_twai_config_t;
+
+bool can_source_twai_open(can_source_t *src, const can_twai_config_t *cfg);
+
+// Replays a candump log ("(1436509052.249713) can0 7E8#03410D32") as if it
+// were the bus. Frames fall due at the pace of their timestamps, measured
+// from the first frame of each pass, and the log restarts at its end. A due
+// frame is only returned when it answers the last OBD-II request sent; the
+// others go by unseen, as they would on a bus nobody asked. recv sleeps
+// through the wait instead of spinning.
+typedef struct {
+    const char *path;
+    int64_t (*now_us)(void);
+    void (*sleep_ms)(uint32_t ms);
+} can_replay_config_t;
+
+typedef struct {
+    FILE *file;
+    can_replay_config_t cfg;
+    uint32_t line;
+    uint32_t bad_lines;
+    uint32_t unrequested;       // due frames nobody had asked for
+    can_frame_t next;
+    bool have_next;
+    bool rebase;                // next frame starts a pass and sets the time base
+    uint64_t next_log_us;
+    uint64_t base_log_us;
+    int64_t base_us;
+    can_frame_t request;
+    bool have_request;
+} can_replay_t;
+
+bool can_source_replay_open(can_source_t *src, can_replay_t *replay, const can_replay_config_t *cfg);
+void can_source_replay_close(can_source_t *src);
+
+// Parses the frame of one candump log line. Exposed for callers that read
+// logs themselves.
+bool can_replay_parse_line(const char *line, can_frame_t *frame);
+
+// Parses the "(seconds.fraction)" timestamp that starts a candump log line.
+bool can_replay_parse_time(const char *line, uint64_t *time_us);
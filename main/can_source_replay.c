@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "can_source.h"
+#include "obd_bridge.h"
+
+
+static int hex_nibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+
+bool can_replay_parse_line(const char *line, can_frame_t *frame) {
+    // skip "(timestamp) interface " and land on "ID#DATA"
+    const char *p = strchr(line, '#');
+    if (p == NULL) return false;
+
+    const char *id_start = p;
+    while (id_start > line && isxdigit((unsigned char)id_start[-1])) id_start--;
+    if (id_start == p || p - id_start > 8) return false;
+
+    frame->id = (uint32_t)strtoul(id_start, NULL, 16);
+    frame->dlc = 0;
+
+    for (p++; frame->dlc < CAN_MAX_DLC; p += 2) {
+        if (*p == '.') p++; // optional byte separator
+        int hi = hex_nibble(p[0]);
+        if (hi < 0) break;
+        int lo = hex_nibble(p[1]);
+        if (lo < 0) return false;
+        frame->data[frame->dlc++] = (uint8_t)((hi << 4) | lo);
+    }
+
+    return true;
+}
+
+
+bool can_replay_parse_time(const char *line, uint64_t *time_us) {
+    uint64_t frac = 0;
+    int digits = 0;
+    char *end;
+
+    while (*line == ' ') line++;
+    if (*line != '(' || !isdigit((unsigned char)line[1])) return false;
+
+    uint64_t sec = strtoull(line + 1, &end, 10);
+    if (*end == '.') {
+        for (end++; isdigit((unsigned char)*end); end++) {
+            if (digits < 6) {
+                frac = frac * 10 + (uint64_t)(*end - '0');
+                digits++;
+            }
+        }
+    }
+    if (*end != ')') return false;
+
+    for (; digits < 6; digits++) frac *= 10;
+    *time_us = sec * 1000000 + frac;
+    return true;
+}
+
+
+// Reads the next parseable line into replay->next. Returns false at the end
+// of the log, which is rewound for the next call.
+static bool replay_read_next(can_replay_t *replay, int64_t now) {
+    char line[128];
+
+    while (fgets(line, sizeof(line), replay->file) != NULL) {
+        uint64_t log_us;
+
+        replay->line++;
+        if (!can_replay_parse_line(line, &replay->next)) {
+            replay->bad_lines++;
+            continue;
+        }
+
+        // lines without a timestamp fall due with the one before them
+        if (can_replay_parse_time(line, &log_us)) {
+            if (log_us < replay->base_log_us) replay->rebase = true;
+            replay->next_log_us = log_us;
+        }
+        if (replay->rebase) {
+            replay->rebase = false;
+            replay->base_log_us = replay->next_log_us;
+            replay->base_us = now;
+        }
+        replay->have_next = true;
+        return true;
+    }
+
+    rewind(replay->file);
+    replay->line = 0;
+    replay->rebase = true;
+    return false;
+}
+
+
+static bool replay_answers_request(const can_replay_t *replay, const can_frame_t *frame) {
+    const can_frame_t *req = &replay->request;
+
+    if (!replay->have_request) return false;
+    if ((frame->id & OBD_RESPONSE_ID_MASK) != OBD_RESPONSE_ID_BASE || frame->dlc < 3) return false;
+    return frame->data[1] == (req->data[1] | 0x40) && frame->data[2] == req->data[2];
+}
+
+
+static void replay_sleep_until(can_replay_t *replay, int64_t until, int64_t now) {
+    if (until > now) {
+        replay->cfg.sleep_ms((uint32_t)((until - now + 999) / 1000));
+    }
+}
+
+
+static bool replay_recv(can_source_t *src, can_frame_t *frame, uint32_t timeout_ms) {
+    can_replay_t *replay = src->ctx;
+    int64_t deadline = replay->cfg.now_us() + (int64_t)timeout_ms * 1000;
+    int ends = 0;
+
+    for (;;) {
+        int64_t now = replay->cfg.now_us();
+
+        if (!replay->have_next && !replay_read_next(replay, now)) {
+            // one pass per call at most, so an unanswering log cannot spin
+            if (++ends < 2) continue;
+            replay_sleep_until(replay, deadline, now);
+            return false;
+        }
+
+        int64_t due = replay->base_us + (int64_t)(replay->next_log_us - replay->base_log_us);
+        if (due <= now) {
+            replay->have_next = false;
+            if (replay_answers_request(replay, &replay->next)) {
+                *frame = replay->next;
+                replay->have_request = false;
+                return true;
+            }
+            replay->unrequested++;
+            continue;
+        }
+
+        if (now >= deadline) return false;
+        replay_sleep_until(replay, due < deadline ? due : deadline, now);
+    }
+}
+
+
+static bool replay_send(can_source_t *src, const can_frame_t *frame) {
+    can_replay_t *replay = src->ctx;
+
+    if (frame->id == OBD_REQUEST_ID && frame->dlc >= 3) {
+        replay->request = *frame;
+        replay->have_request = true;
+    }
+    return true;
+}
+
+
+bool can_source_replay_open(can_source_t *src, can_replay_t *replay, const can_replay_config_t *cfg) {
+    if (cfg->now_us == NULL || cfg->sleep_ms == NULL) return false;
+
+    memset(replay, 0, sizeof(*replay));
+    replay->file = fopen(cfg->path, "r");
+    if (replay->file == NULL) return false;
+
+    replay->cfg = *cfg;
+    replay->rebase = true;
+
+    src->recv = replay_recv;
+    src->send = replay_send;
+    src->ctx = replay;
+    return true;
+}
+
+
+void can_source_replay_close(can_source_t *src) {
+    can_replay_t *replay = src->ctx;
+
+    if (replay != NULL && replay->file != NULL) {
+        fclose(replay->file);
+        replay->file = NULL;
+    }
+}
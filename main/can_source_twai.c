@@ -0,0 +1,162 @@
+#include <stdatomic.h>
+#include <string.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+#include <esp_twai.h>
+#include <esp_twai_onchip.h>
+#include <esp_log.h>
+
+#include "can_source.h"
+#include "obd_bridge.h"
+
+#define CAN_TWAI_RX_QUEUE_DEPTH     16
+#define CAN_TWAI_TX_QUEUE_DEPTH     4
+
+static const char *TAG_TWAI = "TWAI";
+
+typedef struct {
+    twai_node_handle_t node;
+    QueueHandle_t rx_queue;
+    uint32_t wanted[256 / 32];      // PID bitmap checked in the ISR
+    // The driver holds on to a queued frame and its buffer until it is sent,
+    // so there is one pair per queue entry. Frames leave in the order they
+    // were queued, so the slot after the last one used is always the oldest.
+    twai_frame_t tx_frames[CAN_TWAI_TX_QUEUE_DEPTH];
+    uint8_t tx_buffs[CAN_TWAI_TX_QUEUE_DEPTH][CAN_MAX_DLC];
+    uint32_t tx_next;
+    atomic_uint tx_pending;         // queued and not yet done, freed in the ISR
+} can_twai_t;
+
+static can_twai_t twai_ctx;
+
+
+static bool twai_rx_cb(twai_node_handle_t handle, const twai_rx_done_event_data_t *edata, void *user_ctx) {
+    can_twai_t *ctx = user_ctx;
+    can_frame_t frame;
+    twai_frame_t rx_frame = {
+        .buffer = frame.data,
+        .buffer_len = sizeof(frame.data),
+    };
+    BaseType_t woken = pdFALSE;
+
+    (void)edata;
+
+    if (twai_node_receive_from_isr(handle, &rx_frame) != ESP_OK) return false;
+
+    frame.id = rx_frame.header.id;
+    frame.dlc = rx_frame.header.dlc;
+
+    // ID filtering is done by the controller, the PID check is left to us
+    if (frame.dlc < 3 || frame.data[1] != OBD_MODE_CURRENT_DATA_REPLY) return false;
+    if ((ctx->wanted[frame.data[2] / 32] & (1u << (frame.data[2] % 32))) == 0) return false;
+
+    xQueueSendFromISR(ctx->rx_queue, &frame, &woken);
+    return woken == pdTRUE;
+}
+
+
+static bool twai_tx_cb(twai_node_handle_t handle, const twai_tx_done_event_data_t *edata, void *user_ctx) {
+    can_twai_t *ctx = user_ctx;
+
+    (void)handle;
+    (void)edata;
+
+    atomic_fetch_sub(&ctx->tx_pending, 1);
+    return false;
+}
+
+
+static bool twai_recv(can_source_t *src, can_frame_t *frame, uint32_t timeout_ms) {
+    can_twai_t *ctx = src->ctx;
+
+    return xQueueReceive(ctx->rx_queue, frame, pdMS_TO_TICKS(timeout_ms)) == pdTRUE;
+}
+
+
+static bool twai_send(can_source_t *src, const can_frame_t *frame) {
+    can_twai_t *ctx = src->ctx;
+
+    // every slot still queued, e.g. while no ECU acknowledges
+    if (atomic_load(&ctx->tx_pending) >= CAN_TWAI_TX_QUEUE_DEPTH) return false;
+
+    uint32_t slot = ctx->tx_next % CAN_TWAI_TX_QUEUE_DEPTH;
+    twai_frame_t *tx_frame = &ctx->tx_frames[slot];
+
+    memcpy(ctx->tx_buffs[slot], frame->data, frame->dlc);
+
+    *tx_frame = (twai_frame_t) {
+        .header.id = frame->id,
+        .header.dlc = frame->dlc,
+        .buffer = ctx->tx_buffs[slot],
+        .buffer_len = frame->dlc,
+    };
+
+    // counted before queueing, the frame may be done before transmit returns
+    atomic_fetch_add(&ctx->tx_pending, 1);
+    if (twai_node_transmit(ctx->node, tx_frame, 0) != ESP_OK) {
+        atomic_fetch_sub(&ctx->tx_pending, 1);
+        return false;
+    }
+
+    ctx->tx_next++;
+    return true;
+}
+
+
+bool can_source_twai_open(can_source_t *src, const can_twai_config_t *cfg) {
+    can_twai_t *ctx = &twai_ctx;
+
+    memset(ctx->wanted, 0, sizeof(ctx->wanted));
+    ctx->tx_next = 0;
+    atomic_store(&ctx->tx_pending, 0);
+    for (size_t i = 0; i < cfg->n_pids; i++) {
+        ctx->wanted[cfg->pids[i] / 32] |= 1u << (cfg->pids[i] % 32);
+    }
+
+    ctx->rx_queue = xQueueCreate(CAN_TWAI_RX_QUEUE_DEPTH, sizeof(can_frame_t));
+    if (ctx->rx_queue == NULL) return false;
+
+    twai_onchip_node_config_t node_config = {
+        .io_cfg.tx = cfg->tx_gpio,
+        .io_cfg.rx = cfg->rx_gpio,
+        .io_cfg.quanta_clk_out = -1,
+        .io_cfg.bus_off_indicator = -1,
+        .bit_timing.bitrate = cfg->bitrate,
+        .tx_queue_depth = CAN_TWAI_TX_QUEUE_DEPTH,
+    };
+
+    esp_err_t err = twai_new_node_onchip(&node_config, &ctx->node);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG_TWAI, ">> Error: TWAI node could not be created: %s", esp_err_to_name(err));
+        return false;
+    }
+
+    // 0x7E8..0x7EF, the physical response IDs of up to eight ECUs
+    twai_mask_filter_config_t filter = {
+        .id = OBD_RESPONSE_ID_BASE,
+        .mask = OBD_RESPONSE_ID_MASK,
+        .is_ext = false,
+    };
+
+    twai_event_callbacks_t cbs = {
+        .on_rx_done = twai_rx_cb,
+        .on_tx_done = twai_tx_cb,
+    };
+
+    err = twai_node_config_mask_filter(ctx->node, 0, &filter);
+    if (err == ESP_OK) err = twai_node_register_event_callbacks(ctx->node, &cbs, ctx);
+    if (err == ESP_OK) err = twai_node_enable(ctx->node);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG_TWAI, ">> Error: TWAI node could not be started: %s", esp_err_to_name(err));
+        twai_node_delete(ctx->node);
+        return false;
+    }
+
+    src->recv = twai_recv;
+    src->send = twai_send;
+    src->ctx = ctx;
+    return true;
+}
@@ -7,27 +7,46 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/queue.h>
+#include <freertos/semphr.h>
 #include <freertos/event_groups.h>
 
-#include <esp_timer.h>
-#include <esp_twai.h>
-#include <esp_twai_onchip.h>
-#include <esp_wifi.h>
-#include <esp_now.h>
-#include <esp_event.h>
-#include <esp_netif.h>
-#include <nvs_flash.h>
 #include <esp_log.h>
-#include <esp_random.h>
+
+#include "port.h"
+#include "pkt_pool.h"
+#include "recv_ring.h"
+#include "frame_codec.h"
+#include "can_source.h"
+#include "obd_bridge.h"
+#include "tx_sched.h"
+#include "peer_table.h"
+#include "telemetry.h"
+#include "value_cache.h"
 
 #define DATA_SPEED                  0x41
 #define DATA_ENGINE_LOAD            0x04
 
+#define OBD_PID_ENGINE_LOAD         0x04
+#define OBD_PID_SPEED               0x0D
+
 #define STATUS_ESP_NOW              (1 << 0)
 
 #define TASK_ESP_NOW_RECEIVE        (1 << 0)
 #define TASK_ESP_NOW_SEND_DATA      (1 << 1)
-#define TASK_DISPLAY_REGISTERS      (1 << 2)
+#define TASK_TELEMETRY              (1 << 2)
+#define TASK_GENERATE_DATA          (1 << 3)
+
+#define TX_ACK_TIMEOUT_MS           100     // send-complete report overdue
+
+// Requests to the radio task, as notification bits
+#define RADIO_REQ_START             (1 << 0)
+#define RADIO_REQ_RESTART           (1 << 1)
+#define RADIO_REQ_SAVE              (1 << 2)
+
+#define RADIO_RETRY_MS              1000    // between failed bring-up attempts
+#define RADIO_ERROR_LIMIT           3       // consecutive radio errors before ESP-NOW is restarted
+#define RADIO_STATE_KEY             "radio"
+#define RADIO_STATE_VERSION         1
 
 #define BROADCAST_MAC   { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF }
 
@@ -35,71 +54,253 @@ EventGroupHandle_t STATUS_REG;
 EventGroupHandle_t TASK_REG;
 
 TaskHandle_t vTask_start_esp_now_hdl;
+TaskHandle_t vTask_esp_now_receive_hdl;
+TaskHandle_t vTask_esp_now_send_data_hdl;
+TaskHandle_t vTask_telemetry_hdl;
 
-QueueHandle_t queue_esp_now_recv;
+QueueHandle_t queue_esp_now_send;
+QueueHandle_t queue_esp_now_status;
 
 static const char *TAG_ESP_NOW = "ESP-NOW"; 
 static const char *TAG_MAIN = "MAIN";
 static const char *TAG_RECEIVE = "RECEIVE"; 
 static const char *TAG_SEND_DATA = "SEND DATA";  
+static const char *TAG_GENERATE = "GENERATE";
+static const char *TAG_CAN_BRIDGE = "CAN BRIDGE";
+static const char *TAG_PEERS = "PEERS";
+static const char *TAG_TELEMETRY = "TELEMETRY";
+
+_Static_assert(PKT_POOL_ADDR_LEN == PORT_ADDR_LEN, "pool address length must match the radio");
+_Static_assert(PKT_POOL_MTU >= PORT_MTU, "pool slots must hold a full radio frame");
+_Static_assert(FRAME_MAX_LEN <= PORT_MTU, "coalesced frame must fit one radio payload");
+_Static_assert(TX_SCHED_ADDR_LEN == PORT_ADDR_LEN && TX_SCHED_MTU >= FRAME_MAX_LEN, "scheduler slots must hold a frame");
+_Static_assert(PEER_ADDR_LEN == PORT_ADDR_LEN && PEER_TABLE_MAX >= PORT_MAX_PEERS - 1, "peer table must cover the radio's peer list");
+_Static_assert(TX_SCHED_SLOTS >= PORT_MAX_PEERS, "scheduler must hold a fan-out to every peer");
+_Static_assert(VALUE_CACHE_PEERS >= PEER_TABLE_MAX, "value cache needs a row per peer table slot");
 
-uint8_t global_peer_addr[ESP_NOW_ETH_ALEN] = {0};
+typedef struct {
+    uint8_t dest_addr[PORT_ADDR_LEN];
+    bool success;
+} esp_now_send_status_msg_t;
 
+// A record on its way to the send task, stamped when its value was produced
 typedef struct {
-	uint8_t tag;
-	uint8_t data;
-} esp_now_data_packet_t; 
+    frame_record_t rec;
+    int64_t made_us;
+} esp_now_send_item_t;
 
-typedef struct { 
-	uint8_t source_addr[ESP_NOW_ETH_ALEN];
-	uint8_t destination_addr[ESP_NOW_ETH_ALEN];
-	uint8_t tag;
-	uint8_t *pData; 
-	int len;
-} esp_now_data_packet_buff_t; 
+// Saved so a reboot can unicast to known peers right away instead of
+// waiting to hear from each of them again
+typedef struct {
+    uint8_t version;
+    uint8_t channel;
+    uint8_t n_peers;
+    uint8_t peers[PEER_TABLE_MAX][PORT_ADDR_LEN];
+} radio_state_t;
 
+_Static_assert((CONFIG_ESPNOW_RECV_RING_DEPTH & (CONFIG_ESPNOW_RECV_RING_DEPTH - 1)) == 0, "receive ring depth must be a power of two");
 
+static pkt_pool_t recv_pool;
+static recv_ring_t recv_ring;
 
-// takes the MAC Addr and sends it to task register. 
-void esp_now_recv_cb(const esp_now_recv_info_t *esp_now_info, const uint8_t *data, int len) {
+static const obd_pid_t obd_pids[] = {
+    { .pid = OBD_PID_SPEED,       .tag = DATA_SPEED,       .len = 1, .poll_ms = 100, .refresh_ms = 1000 },
+    { .pid = OBD_PID_ENGINE_LOAD, .tag = DATA_ENGINE_LOAD, .len = 1, .poll_ms = 100, .refresh_ms = 1000 },
+};
+
+static can_source_t can_source;
+static obd_bridge_t obd_bridge;
+static bool obd_bridge_running = false;
+
+static tx_sched_t tx_sched;
+
+// Peers learned from received frames. The broadcast peer takes one of the
+// ESP-NOW peer entries, the table gets the rest.
+static peer_table_t peer_table;
+static SemaphoreHandle_t peer_table_lock;
+
+// Latest value per peer slot and tag; written by the receive task only
+static value_cache_t value_cache;
+
+static int64_t boot_us;
 
-    esp_now_data_packet_buff_t pkt;
-    esp_now_data_packet_buff_t *data_pkt = (esp_now_data_packet_buff_t *)data;
-    
-	if (!esp_now_info || !data || len <= 0) return; 
 
-    memcpy(pkt.source_addr, esp_now_info->src_addr, ESP_NOW_ETH_ALEN);
-    memcpy(pkt.destination_addr, esp_now_info->des_addr, ESP_NOW_ETH_ALEN);
-    pkt.tag = data_pkt->tag;
-    pkt.len = len;
 
-    pkt.pData = malloc(len);
-    if (pkt.pData == NULL) return;
-    memcpy(pkt.pData, data, len);
+// Copies the frame into a pool slot and passes the slot index to the receive task.
+// Runs in the Wi-Fi task; never blocks.
+void esp_now_recv_cb(const uint8_t *src_addr, const uint8_t *dest_addr, const uint8_t *data, int len) {
+
+    // ESP-NOW v2 peers may send up to 1470 bytes, more than a slot holds
+    if (!data || len <= 0 || len > PKT_POOL_MTU) {
+        telemetry_inc(TM_RX_OVERSIZE);
+        return;
+    }
+
+    uint8_t idx = pkt_pool_alloc(&recv_pool);
+    if (idx == PKT_POOL_INVALID) {
+        telemetry_inc(TM_RX_POOL_EMPTY);
+        return;
+    }
+
+    esp_now_data_packet_buff_t *pkt = pkt_pool_slot(&recv_pool, idx);
+    memcpy(pkt->source_addr, src_addr, PORT_ADDR_LEN);
+    memcpy(pkt->destination_addr, dest_addr, PORT_ADDR_LEN);
+    pkt->len = len;
+    pkt->rx_time_us = (uint32_t)port_time_us();
+    memcpy(pkt->data, data, len);
 	
-	xQueueSend(queue_esp_now_recv, &pkt, 0);   
+	if (!recv_ring_push(&recv_ring, idx)) {
+        pkt_pool_free(&recv_pool, idx); // ring full, slot is still ours
+        telemetry_inc(TM_RX_DROPPED);
+        return;
+    }
+
+    telemetry_inc(TM_RX_FRAMES);
+
+    xTaskNotifyGive(vTask_esp_now_receive_hdl);
 		
 } 
 
 
-// ESP-NOW RECEIVE: 
+// Reports the send result to the send task, which owns the scheduler.
+// Runs in the Wi-Fi task; never blocks.
+void esp_now_send_cb(const uint8_t *dest_addr, bool success) {
+    esp_now_send_status_msg_t msg;
+
+    memcpy(msg.dest_addr, dest_addr, PORT_ADDR_LEN);
+    msg.success = success;
+
+    // a lost report is recovered by the scheduler's ack timeout
+    xQueueSend(queue_esp_now_status, &msg, 0);
+    xTaskNotifyGive(vTask_esp_now_send_data_hdl);
+}
+
+
+// Hands a record to the send task
+static bool esp_now_queue_record(const frame_record_t *rec, int64_t made_us) {
+    esp_now_send_item_t item = { .rec = *rec, .made_us = made_us };
+
+    if (xQueueSend(queue_esp_now_send, &item, 0) != pdTRUE) {
+        telemetry_inc(TM_TX_RECORDS_DROPPED);
+        return false;
+    }
+
+    telemetry_gauge_max(TM_GAUGE_SEND_QUEUE_HWM, uxQueueMessagesWaiting(queue_esp_now_send));
+    xTaskNotifyGive(vTask_esp_now_send_data_hdl);
+    return true;
+}
+
+
+// Records the sender of a received frame and registers new peers with ESP-NOW.
+// Returns the sender's peer slot.
+static uint8_t esp_now_learn_peer(const uint8_t *addr) {
+    peer_learn_result_t learned;
+
+    xSemaphoreTake(peer_table_lock, portMAX_DELAY);
+    uint8_t slot = peer_table_learn(&peer_table, addr, (uint32_t)(port_time_us() / 1000), &learned);
+    if (slot != PEER_NONE) peer_table_entry(&peer_table, slot)->stats.rx_frames++;
+    xSemaphoreGive(peer_table_lock);
+
+    if (learned.evicted) {
+        port_radio_del_peer(learned.evicted_addr);
+    }
+
+    if (learned.added) {
+        // the slot may have belonged to an evicted peer
+        value_cache_reset_peer(&value_cache, slot);
+        xTaskNotify(vTask_start_esp_now_hdl, RADIO_REQ_SAVE, eSetBits);
+
+        esp_err_t err = port_radio_add_peer(addr);
+        if (err == ESP_OK) {
+            ESP_LOGI(TAG_PEERS, ">> Info: New peer %02X:%02X:%02X:%02X:%02X:%02X", addr[0], addr[1], addr[2], addr[3], addr[4], addr[5]);
+        } else {
+            ESP_LOGE(TAG_PEERS, ">> Error: Peer could not be added: %s", esp_err_to_name(err));
+        }
+    }
+
+    return slot;
+}
+
+
+// Removes a dropped peer from the radio and has the peer list saved
+static void esp_now_forget_peer(const uint8_t *addr, const char *why) {
+    port_radio_del_peer(addr);
+    xTaskNotify(vTask_start_esp_now_hdl, RADIO_REQ_SAVE, eSetBits);
+    ESP_LOGI(TAG_PEERS, ">> Info: Peer %02X:%02X:%02X:%02X:%02X:%02X dropped, %s", addr[0], addr[1], addr[2], addr[3], addr[4], addr[5], why);
+}
+
+
+// Drops the peers not heard from for CONFIG_ESPNOW_PEER_TIMEOUT_MS. They
+// come off the LRU end, so this only looks at one peer when nobody is due.
+static void esp_now_age_peers(int64_t now) {
+    uint8_t gone[PEER_TABLE_MAX][PORT_ADDR_LEN];
+    uint8_t n = 0;
+    uint8_t slot;
+
+    xSemaphoreTake(peer_table_lock, portMAX_DELAY);
+    while ((slot = peer_table_oldest_idle(&peer_table, (uint32_t)(now / 1000), CONFIG_ESPNOW_PEER_TIMEOUT_MS)) != PEER_NONE) {
+        memcpy(gone[n++], peer_table_entry(&peer_table, slot)->addr, PORT_ADDR_LEN);
+        peer_table_remove(&peer_table, slot);
+    }
+    xSemaphoreGive(peer_table_lock);
+
+    for (uint8_t i = 0; i < n; i++) {
+        esp_now_forget_peer(gone[i], "timed out");
+    }
+}
+
+
+// ESP-NOW RECEIVE: decodes received frames into the value cache
 void vTask_esp_now_receive(void *args) {
 
-	uint8_t broadcast_addr[ESP_NOW_ETH_ALEN] = BROADCAST_MAC;
-	esp_now_data_packet_buff_t pkt;
-    uint8_t source_addr_buff[ESP_NOW_ETH_ALEN]; 
+	uint8_t broadcast_addr[PORT_ADDR_LEN] = BROADCAST_MAC;
+	uint8_t batch[CONFIG_ESPNOW_RECV_BATCH];
+    uint32_t n;
+    uint32_t missed;
+    frame_dec_t dec;
+    frame_record_t rec;
 	
 	for (;;) {
 		xEventGroupWaitBits(TASK_REG, TASK_ESP_NOW_RECEIVE, pdFALSE, pdFALSE, portMAX_DELAY);
         
         while (xEventGroupGetBits(TASK_REG) & TASK_ESP_NOW_RECEIVE) {
-            if (xQueueReceive(queue_esp_now_recv, &pkt, portMAX_DELAY) == pdTRUE) {
-
-                free(pkt.pData); // free the heap 
-                memcpy(source_addr_buff, pkt.source_addr, ESP_NOW_ETH_ALEN);
-
-                if (memcmp(pkt.source_addr, broadcast_addr, ESP_NOW_ETH_ALEN) == 0) {
-                   ESP_LOGI(TAG_RECEIVE, "Data Received from: %02X %02X %02X %02X %02X %02X", source_addr_buff[0] , source_addr_buff[1], source_addr_buff[2], source_addr_buff[3], source_addr_buff[4], source_addr_buff[5]); 
+            // one wake-up per burst, the notify count is only a hint
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+            while ((n = recv_ring_pop_batch(&recv_ring, batch, CONFIG_ESPNOW_RECV_BATCH)) > 0) {
+                for (uint32_t i = 0; i < n; i++) {
+
+                    esp_now_data_packet_buff_t *pkt = pkt_pool_slot(&recv_pool, batch[i]);
+                    telemetry_record_us(TM_HIST_RX_LATENCY, (uint32_t)port_time_us() - pkt->rx_time_us);
+                    const uint8_t *src = pkt->source_addr;
+                    bool is_broadcast = memcmp(pkt->destination_addr, broadcast_addr, PORT_ADDR_LEN) == 0;
+                    uint32_t now_ms = (uint32_t)(port_time_us() / 1000);
+                    uint8_t peer = PEER_NONE;
+
+                    ESP_LOGD(TAG_RECEIVE, "%s data received from: %02X %02X %02X %02X %02X %02X", is_broadcast ? "Broadcast" : "Unicast", src[0], src[1], src[2], src[3], src[4], src[5]);
+
+                    // only a sender speaking our format becomes a peer, so
+                    // foreign traffic never takes a slot from a real one
+                    bool decoded = frame_dec_begin(&dec, pkt->data, pkt->len);
+                    if (decoded) peer = esp_now_learn_peer(src);
+
+                    if (!decoded) {
+                        telemetry_inc(TM_RX_BAD_FRAMES); // other ESP-NOW users on the channel end up here too
+                        ESP_LOGD(TAG_RECEIVE, "Unknown frame format, %u bytes", pkt->len);
+                    } else if (!value_cache_begin_frame(&value_cache, peer, dec.epoch, dec.seq, &missed)) {
+                        telemetry_inc(TM_RX_DUPLICATES);
+                        ESP_LOGD(TAG_RECEIVE, "Seq: %u repeated or late, ignored", dec.seq);
+                    } else {
+                        if (missed > 0) telemetry_add(TM_RX_GAPS, missed);
+
+                        while (frame_dec_next(&dec, &rec)) {
+                            telemetry_inc(TM_RX_RECORDS);
+                            value_cache_put(&value_cache, peer, &rec, dec.seq, now_ms);
+                            ESP_LOGD(TAG_RECEIVE, "Seq: %u Tag: %02X Data: %lu", dec.seq, rec.tag, (unsigned long)rec.value);
+                        }
+                    }
+
+                    pkt_pool_free(&recv_pool, batch[i]); // slot goes back to the callback
                 }
             }
     	}
@@ -108,134 +309,571 @@ void vTask_esp_now_receive(void *args) {
 
 
 
+// Loads the peer list saved by the last run into the peer table. A list
+// saved on another channel is of no use and is ignored. Needs the store,
+// which the port only brings up with the radio.
+static void radio_state_restore(void) {
+    radio_state_t state;
+    peer_learn_result_t learned;
+    size_t len = sizeof(state);
+
+    esp_err_t err = port_store_load(RADIO_STATE_KEY, &state, &len);
+    if (err == ESP_ERR_NOT_FOUND) return;
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG_PEERS, ">> Warning: Saved peer list could not be loaded: %s", esp_err_to_name(err));
+        return;
+    }
+    if (len != sizeof(state) || state.version != RADIO_STATE_VERSION || state.channel != CONFIG_ESPNOW_CHANNEL || state.n_peers > peer_table.capacity) {
+        ESP_LOGW(TAG_PEERS, ">> Warning: Saved peer list ignored");
+        return;
+    }
+
+    xSemaphoreTake(peer_table_lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < state.n_peers; i++) {
+        peer_table_learn(&peer_table, state.peers[i], (uint32_t)(port_time_us() / 1000), &learned);
+    }
+    xSemaphoreGive(peer_table_lock);
+
+    ESP_LOGI(TAG_PEERS, ">> Info: %u saved peers restored", state.n_peers);
+}
+
+
+// Writes the peer list if it changed since the last save
+static void radio_state_save(void) {
+    static radio_state_t saved;
+    radio_state_t state = { .version = RADIO_STATE_VERSION, .channel = CONFIG_ESPNOW_CHANNEL };
+
+    xSemaphoreTake(peer_table_lock, portMAX_DELAY);
+    for (uint8_t slot = 0; slot < peer_table.slots; slot++) {
+        peer_entry_t *e = peer_table_entry(&peer_table, slot);
+        if (e->in_use) memcpy(state.peers[state.n_peers++], e->addr, PORT_ADDR_LEN);
+    }
+    xSemaphoreGive(peer_table_lock);
+
+    if (memcmp(&state, &saved, sizeof(state)) == 0) return;
+
+    esp_err_t err = port_store_save(RADIO_STATE_KEY, &state, sizeof(state));
+    if (err == ESP_OK) {
+        saved = state;
+    } else {
+        ESP_LOGE(TAG_PEERS, ">> Error: Peer list could not be saved: %s", esp_err_to_name(err));
+    }
+}
+
+
+// Registers the broadcast address and every known peer with the radio
+static void radio_register_peers(void) {
+    static const uint8_t broadcast_addr[PORT_ADDR_LEN] = BROADCAST_MAC;
+
+    port_radio_add_peer(broadcast_addr);
+
+    xSemaphoreTake(peer_table_lock, portMAX_DELAY);
+    for (uint8_t slot = 0; slot < peer_table.slots; slot++) {
+        peer_entry_t *e = peer_table_entry(&peer_table, slot);
+        if (e->in_use) port_radio_add_peer(e->addr);
+    }
+    xSemaphoreGive(peer_table_lock);
+}
+
+
+// Brings the radio up and keeps it up. Requests arrive as notification bits:
+// RADIO_REQ_START from app_main, RADIO_REQ_RESTART from the send task after
+// repeated radio errors and RADIO_REQ_SAVE when the peer list changed, which
+// is written out CONFIG_ESPNOW_STATE_SAVE_MS later. A failed bring-up is
+// retried from the stage that failed; STATUS_ESP_NOW is set while ESP-NOW is
+// usable.
 void vTask_start_esp_now(void *pvParameters) {
+    uint32_t pending = 0;
+    uint32_t req;
+    int64_t save_at = 0;
+    bool started = false;
+    TickType_t wait;
 
     for (;;) {
-        
-        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-
-        ESP_LOGW(TAG_ESP_NOW, "STARTING ESP-NOW...");
-    	esp_err_t ret = nvs_flash_init();  
-    	ESP_ERROR_CHECK(ret); 								  
-    	ESP_ERROR_CHECK(esp_netif_init());
-    	ESP_ERROR_CHECK(esp_event_loop_create_default());
-    	wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT(); 				 
-    	ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-    	ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    	ESP_ERROR_CHECK(esp_wifi_start());
-        ESP_ERROR_CHECK(esp_wifi_set_channel(1, WIFI_SECOND_CHAN_NONE));
-    	esp_err_t init = esp_now_init();
-        esp_err_t err = esp_now_register_recv_cb(esp_now_recv_cb); 
-    
-       vTaskDelay(pdMS_TO_TICKS(50));
+        int64_t now = port_time_us();
+
+        if (pending & (RADIO_REQ_START | RADIO_REQ_RESTART)) {
+            bool ready = xEventGroupGetBits(STATUS_REG) & STATUS_ESP_NOW;
+            esp_err_t err = ESP_OK;
+
+            if (pending & RADIO_REQ_RESTART) {
+                ESP_LOGW(TAG_ESP_NOW, "RESTARTING ESP-NOW...");
+                xEventGroupClearBits(STATUS_REG, STATUS_ESP_NOW);
+                telemetry_inc(TM_RADIO_RESTARTS);
+                err = port_radio_restart();
+                ready = false;
+            } else if (!ready) {
+                ESP_LOGW(TAG_ESP_NOW, "STARTING ESP-NOW...");
+                err = port_radio_init(CONFIG_ESPNOW_CHANNEL, esp_now_recv_cb, esp_now_send_cb);
+            }
 
-       if (err != ESP_OK) {
-           ESP_LOGE(TAG_ESP_NOW, ">> Error: ESP-NOW callback could not be registered!");
-           return; 
-       }
-    
-       if (init != ESP_OK) {
-             ESP_LOGE(TAG_ESP_NOW, ">> Error: ESP-NOW could not be initialised!");
-            return;
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG_ESP_NOW, ">> Error: ESP-NOW could not be initialised: %s", esp_err_to_name(err));
+            } else {
+                if (!started) {
+                    radio_state_restore();
+                }
+                if (!ready) {
+                    radio_register_peers();
+                    xEventGroupSetBits(STATUS_REG, STATUS_ESP_NOW);
+                    xTaskNotifyGive(vTask_esp_now_send_data_hdl);
+                    ESP_LOGW(TAG_ESP_NOW, ">> Info: ESP-NOW initiated successfully!");
+                }
+                if (!started) {
+                    started = true;
+                    telemetry_gauge_set(TM_GAUGE_READY_MS, (uint32_t)((port_time_us() - boot_us) / 1000));
+                }
+                pending &= ~(RADIO_REQ_START | RADIO_REQ_RESTART);
+            }
+        }
+
+        if ((pending & RADIO_REQ_SAVE) && now >= save_at) {
+            radio_state_save();
+            pending &= ~RADIO_REQ_SAVE;
+        }
+
+        if (pending & (RADIO_REQ_START | RADIO_REQ_RESTART)) {
+            wait = pdMS_TO_TICKS(RADIO_RETRY_MS);
+        } else if (pending & RADIO_REQ_SAVE) {
+            wait = pdMS_TO_TICKS((save_at - now) / 1000) + 1;
+        } else {
+            wait = portMAX_DELAY;
+        }
+
+        if (xTaskNotifyWait(0, UINT32_MAX, &req, wait) == pdTRUE) {
+            if ((req & RADIO_REQ_SAVE) && !(pending & RADIO_REQ_SAVE)) {
+                save_at = port_time_us() + CONFIG_ESPNOW_STATE_SAVE_MS * 1000LL;
+            }
+            pending |= req;
         }
-    
-       ESP_LOGW(TAG_ESP_NOW, ">> Info: ESP-NOW initiated successfully!");
-       xEventGroupSetBits(STATUS_REG, STATUS_ESP_NOW);
     }
-	
 }
 
 
 
-// Broadcasts random data via ESP-NOW
-void vTask_esp_now_send_data(void *args) {
-    uint8_t randint = 0;
-    bool data_type = 1;
-    uint8_t broadcast_addr[ESP_NOW_ETH_ALEN] = BROADCAST_MAC;
+// Produces random sensor values for the send pipeline
+void vTask_generate_data(void *args) {
+    frame_record_t rec = { .len = 1 };
+
+    for (;;) {
+        xEventGroupWaitBits(TASK_REG, TASK_GENERATE_DATA, pdFALSE, pdFALSE, portMAX_DELAY);
+
+        while (xEventGroupGetBits(TASK_REG) & TASK_GENERATE_DATA) {
+
+            rec.tag = DATA_SPEED;
+            rec.value = port_random() & 0xFF;
+            if (!esp_now_queue_record(&rec, port_time_us())) {
+                ESP_LOGW(TAG_GENERATE, ">> Warning: Send queue full, value dropped");
+            }
+
+            rec.tag = DATA_ENGINE_LOAD;
+            rec.value = port_random() & 0xFF;
+            if (!esp_now_queue_record(&rec, port_time_us())) {
+                ESP_LOGW(TAG_GENERATE, ">> Warning: Send queue full, value dropped");
+            }
+
+            vTaskDelay(pdMS_TO_TICKS(CONFIG_ESPNOW_GENERATE_INTERVAL_MS));
+        }
+    }
+}
 
-	esp_now_data_packet_t pkt = {0}; 
-	esp_now_peer_info_t peer = {0};
-    memcpy(peer.peer_addr, broadcast_addr, ESP_NOW_ETH_ALEN);
-	peer.ifidx = WIFI_IF_STA;
-    peer.channel = 0;
-	peer.encrypt = false;	 
+
+// Polls OBD-II PIDs from the CAN source and forwards changed values to the
+// send pipeline. Stops polling while the send queue is nearly full.
+void vTask_can_bridge(void *args) {
+    can_frame_t frame;
+    frame_record_t rec;
+    uint32_t value_ms;
+
+    for (;;) {
+        xEventGroupWaitBits(TASK_REG, TASK_GENERATE_DATA, pdFALSE, pdFALSE, portMAX_DELAY);
+
+        while (xEventGroupGetBits(TASK_REG) & TASK_GENERATE_DATA) {
+            int64_t now_us = port_time_us();
+            uint32_t now = (uint32_t)(now_us / 1000);
+
+            if (obd_bridge_next_request(&obd_bridge, now, uxQueueSpacesAvailable(queue_esp_now_send), &frame)) {
+                if (!can_source.send(&can_source, &frame)) {
+                    ESP_LOGW(TAG_CAN_BRIDGE, ">> Warning: OBD request for PID %02X not sent", frame.data[2]);
+                }
+            }
+
+            if (can_source.recv(&can_source, &frame, 10)) {
+                obd_bridge_on_frame(&obd_bridge, &frame, (uint32_t)(port_time_us() / 1000));
+            }
+
+            // the receive may have waited, and the response is stamped after it
+            now_us = port_time_us();
+            now = (uint32_t)(now_us / 1000);
+
+            while (obd_bridge_take(&obd_bridge, now, &rec, &value_ms)) {
+                // the value was produced when its response came in
+                if (!esp_now_queue_record(&rec, now_us - (int64_t)(int32_t)(now - value_ms) * 1000)) {
+                    obd_bridge_requeue(&obd_bridge, &rec); // keep the latest value for later
+                    break;
+                }
+            }
+        }
+    }
+}
+
+
+#if CONFIG_ESPNOW_DATA_SOURCE_REPLAY
+static void can_replay_sleep_ms(uint32_t ms) {
+    vTaskDelay(pdMS_TO_TICKS(ms) > 0 ? pdMS_TO_TICKS(ms) : 1);
+}
+#endif
+
+
+#if !CONFIG_ESPNOW_DATA_SOURCE_RANDOM
+// Opens the CAN source selected in menuconfig and starts the bridge task
+static bool can_bridge_start(void) {
+    bool opened = false;
+
+#if CONFIG_ESPNOW_DATA_SOURCE_TWAI
+    static uint8_t pids[sizeof(obd_pids) / sizeof(obd_pids[0])];
+    for (size_t i = 0; i < sizeof(pids); i++) {
+        pids[i] = obd_pids[i].pid;
+    }
+
+    can_twai_config_t cfg = {
+        .tx_gpio = CONFIG_ESPNOW_TWAI_TX_GPIO,
+        .rx_gpio = CONFIG_ESPNOW_TWAI_RX_GPIO,
+        .bitrate = CONFIG_ESPNOW_TWAI_BITRATE,
+        .pids = pids,
+        .n_pids = sizeof(pids),
+    };
+    opened = can_source_twai_open(&can_source, &cfg);
+#elif CONFIG_ESPNOW_DATA_SOURCE_REPLAY
+    static can_replay_t replay;
+    can_replay_config_t cfg = {
+        .path = CONFIG_ESPNOW_REPLAY_PATH,
+        .now_us = port_time_us,
+        .sleep_ms = can_replay_sleep_ms,
+    };
+    opened = can_source_replay_open(&can_source, &replay, &cfg);
+#endif
+
+    if (!opened) {
+        ESP_LOGE(TAG_CAN_BRIDGE, ">> Error: CAN source could not be opened!");
+        return false;
+    }
+
+    obd_bridge_init(&obd_bridge, obd_pids, sizeof(obd_pids) / sizeof(obd_pids[0]));
+    obd_bridge_running = true;
+    xTaskCreate(vTask_can_bridge, "CAN Bridge", 4096, NULL, 1, NULL);
+    return true;
+}
+#endif
+
+
+#if CONFIG_ESPNOW_UNICAST_FANOUT
+static int64_t last_discovery_us;
+#endif
+
+
+// Number of scheduler slots one frame may need
+static uint32_t esp_now_fanout_width(void) {
+#if CONFIG_ESPNOW_UNICAST_FANOUT
+    return peer_table.count > 0 ? peer_table.count : 1; // every peer, or one broadcast
+#else
+    return 1;
+#endif
+}
+
+
+// Finalises the frame and hands a copy per destination to the transmit
+// scheduler. Broadcast mode sends one copy; fan-out mode sends one to each
+// known peer, so every copy is acknowledged, and only broadcasts while it
+// knows no peers. oldest_us is when the frame's oldest value was produced.
+static void esp_now_submit_frame(frame_enc_t *enc, int64_t oldest_us, int64_t now) {
+    static const uint8_t broadcast_addr[PORT_ADDR_LEN] = BROADCAST_MAC;
+    uint8_t count = enc->count;
+    uint16_t len = frame_enc_finish(enc);
+    uint32_t targets = 0;
+    bool broadcast = true;
+
+    esp_now_age_peers(now);
+
+#if CONFIG_ESPNOW_UNICAST_FANOUT
+    xSemaphoreTake(peer_table_lock, portMAX_DELAY);
+    for (uint8_t slot = 0; slot < peer_table.slots; slot++) {
+        peer_entry_t *e = peer_table_entry(&peer_table, slot);
+
+        if (e->in_use && tx_sched_submit(&tx_sched, e->addr, enc->buf, len, oldest_us, now)) {
+            e->stats.tx_frames++;
+            targets++;
+        }
+    }
+    xSemaphoreGive(peer_table_lock);
+
+    // the frame itself is the discovery broadcast until someone answers
+    broadcast = peer_table.count == 0;
+    if (broadcast) last_discovery_us = now;
+#endif
+
+    if (broadcast && tx_sched_submit(&tx_sched, broadcast_addr, enc->buf, len, oldest_us, now)) {
+        targets++;
+    }
+
+    if (targets > 0) {
+       ESP_LOGD(TAG_SEND_DATA, ">> Data queued. Records: %u Bytes: %u Destinations: %lu", count, len, (unsigned long)targets);
+    } else {
+       ESP_LOGE(TAG_SEND_DATA, ">> Error: Transmit scheduler full, frame dropped");
+    }
+}
+
+
+#if CONFIG_ESPNOW_UNICAST_FANOUT
+static bool esp_now_discovery_due(int64_t now) {
+    return now - last_discovery_us >= CONFIG_ESPNOW_DISCOVERY_INTERVAL_MS * 1000LL;
+}
+
+
+// Broadcasts the empty frame under construction so nodes that have not
+// heard from us yet can learn our address. It takes a sequence number of its
+// own: a data frame broadcast on top of its unicast copies would reach
+// known peers twice under the same number and count as a duplicate.
+static void esp_now_submit_beacon(frame_enc_t *enc, int64_t now) {
+    static const uint8_t broadcast_addr[PORT_ADDR_LEN] = BROADCAST_MAC;
+    uint16_t len = frame_enc_finish(enc);
+
+    if (tx_sched_submit(&tx_sched, broadcast_addr, enc->buf, len, now, now)) {
+        last_discovery_us = now;
+    }
+}
+#endif
+
+
+// Updates the per-peer delivery counters from a send-complete report and
+// drops a peer that stopped acknowledging altogether
+static void esp_now_peer_status(const uint8_t *addr, bool success) {
+    bool dropped = false;
+
+    xSemaphoreTake(peer_table_lock, portMAX_DELAY);
+    uint8_t slot = peer_table_find(&peer_table, addr);
+    if (slot != PEER_NONE) {
+        peer_entry_t *e = peer_table_entry(&peer_table, slot);
+        if (success) {
+            e->stats.tx_delivered++;
+            e->tx_fail_streak = 0;
+        } else {
+            e->stats.tx_failed++;
+            if (e->tx_fail_streak < UINT8_MAX) e->tx_fail_streak++;
+#if CONFIG_ESPNOW_UNICAST_FANOUT
+            if (e->tx_fail_streak >= CONFIG_ESPNOW_PEER_MAX_TX_FAILURES) {
+                peer_table_remove(&peer_table, slot);
+                dropped = true;
+            }
+#endif
+        }
+    }
+    xSemaphoreGive(peer_table_lock);
+
+    if (dropped) {
+        esp_now_forget_peer(addr, "not acknowledging");
+    }
+}
+
+
+// Packs queued records into one frame when the frame is full or the oldest
+// record was produced CONFIG_ESPNOW_SEND_FLUSH_MS ago, and transmits frames
+// as the scheduler allows. Woken by new records and by send-complete reports.
+void vTask_esp_now_send_data(void *args) {
+    uint16_t epoch = (uint16_t)port_random(); // tells receivers we rebooted
+    uint16_t seq = 0;
+    uint32_t radio_errors = 0;
+    bool delivered_once = false;
+    int64_t deadline = 0;
+    int64_t oldest_us = 0;
+    uint32_t wait_us;
+    TickType_t wait;
+    esp_now_send_item_t item;
+    frame_enc_t enc;
+    esp_now_send_status_msg_t status;
+    tx_frame_t *frame;
+
+    frame_enc_begin(&enc, epoch, seq);
 
     for (;;) {
         xEventGroupWaitBits(TASK_REG, TASK_ESP_NOW_SEND_DATA, pdFALSE, pdFALSE, portMAX_DELAY);
-        
+
         while (xEventGroupGetBits(TASK_REG) & TASK_ESP_NOW_SEND_DATA) {
+            int64_t now = port_time_us();
+
+            while (xQueueReceive(queue_esp_now_status, &status, 0) == pdTRUE) {
+                uint64_t sent = tx_sched_on_status(&tx_sched, status.dest_addr, status.success, now);
+                if (sent != 0) telemetry_record_us(TM_HIST_TX_ACK_LATENCY, (uint32_t)(now - sent));
+                telemetry_inc(status.success ? TM_TX_DELIVERED : TM_TX_FAILED);
+                if (status.success && !delivered_once) {
+                    delivered_once = true;
+                    telemetry_gauge_set(TM_GAUGE_FIRST_TX_MS, (uint32_t)((now - boot_us) / 1000));
+                    ESP_LOGI(TAG_SEND_DATA, ">> Info: First frame delivered %lu ms after start", (unsigned long)((now - boot_us) / 1000));
+                }
+                esp_now_peer_status(status.dest_addr, status.success);
+            }
+
+            // records stay in the queue while the scheduler is full, which
+            // is what throttles the producers
+            while (tx_sched_free_slots(&tx_sched) >= esp_now_fanout_width() && xQueueReceive(queue_esp_now_send, &item, 0) == pdTRUE) {
+                telemetry_inc(TM_TX_RECORDS);
+
+                if (!frame_enc_add(&enc, &item.rec)) {
+                    esp_now_submit_frame(&enc, oldest_us, now);
+                    frame_enc_begin(&enc, epoch, ++seq);
+                    frame_enc_add(&enc, &item.rec);
+                }
 
-            if (!esp_now_is_peer_exist(peer.peer_addr)) {
-                esp_now_add_peer(&peer);
+                if (enc.count == 1) {
+                    oldest_us = item.made_us;
+                    deadline = oldest_us + CONFIG_ESPNOW_SEND_FLUSH_MS * 1000LL;
+                }
+
+#if !CONFIG_ESPNOW_SEND_COALESCE
+                // one record per frame, the baseline coalescing is measured against
+                esp_now_submit_frame(&enc, oldest_us, now);
+                frame_enc_begin(&enc, epoch, ++seq);
+#endif
             }
 
-            randint = esp_random() & 0xFF;
-            ESP_LOGI(TAG_SEND_DATA, "Random int: %u");
-            pkt.data = randint; 
-            
-            if (data_type) {
-                pkt.tag = DATA_SPEED;
-                data_type = !data_type; 
-            } else {
-                pkt.tag = DATA_ENGINE_LOAD;
-                data_type = !data_type;
-            } 
+            if (!frame_enc_empty(&enc) && tx_sched_free_slots(&tx_sched) >= esp_now_fanout_width() &&
+                (now >= deadline || enc.len + FRAME_RECORD_MAX_LEN > FRAME_MAX_LEN)) {
+                esp_now_submit_frame(&enc, oldest_us, now);
+                frame_enc_begin(&enc, epoch, ++seq);
+            }
 
-            esp_err_t err = esp_now_send(peer.peer_addr, (uint8_t *)&pkt, sizeof(pkt));
- 
-            if (err == ESP_OK) {
-               ESP_LOGW(TAG_SEND_DATA, ">> Data sent. Tag: %02X Data: %u", pkt.tag, pkt.data);
-            } else {
-               ESP_LOGE(TAG_SEND_DATA, ">> Error while sending data: %s", esp_err_to_name(err));
+#if CONFIG_ESPNOW_UNICAST_FANOUT
+            if (frame_enc_empty(&enc) && esp_now_discovery_due(now) && tx_sched_free_slots(&tx_sched) > 0) {
+                esp_now_submit_beacon(&enc, now);
+                frame_enc_begin(&enc, epoch, ++seq);
             }
+#endif
 
-            vTaskDelay(pdMS_TO_TICKS(330));
+            // nothing goes out while the radio is down; the radio task
+            // wakes us when it is back
+            wait_us = TX_SCHED_NO_WAIT;
+            while ((xEventGroupGetBits(STATUS_REG) & STATUS_ESP_NOW) && (frame = tx_sched_next(&tx_sched, now, &wait_us)) != NULL) {
+                esp_err_t err = port_radio_send(frame->dest, frame->buf, frame->len, (int64_t)frame->origin_us);
 
+                if (err == ESP_OK) {
+                   telemetry_inc(TM_TX_FRAMES);
+                   radio_errors = 0;
+                } else {
+                   ESP_LOGE(TAG_SEND_DATA, ">> Error while sending data: %s", esp_err_to_name(err));
+                   telemetry_inc(TM_TX_FAILED);
+                   tx_sched_send_failed(&tx_sched, frame, now);
+
+                   // a full queue or an unknown peer is not the radio's fault
+                   if (err != ESP_ERR_NO_MEM && err != ESP_ERR_NOT_FOUND && ++radio_errors >= RADIO_ERROR_LIMIT) {
+                       radio_errors = 0;
+                       xTaskNotify(vTask_start_esp_now_hdl, RADIO_REQ_RESTART, eSetBits);
+                       break;
+                   }
+                }
+            }
+
+            if (!frame_enc_empty(&enc) && tx_sched_free_slots(&tx_sched) >= esp_now_fanout_width() && (uint64_t)(deadline - now) < wait_us) {
+                wait_us = (uint32_t)(deadline - now);
+            }
+
+            if (wait_us == TX_SCHED_NO_WAIT) {
+                wait = portMAX_DELAY;
+            } else {
+                wait = pdMS_TO_TICKS((wait_us + 999) / 1000);
+                if (wait == 0) wait = 1; // never spin below tick resolution
+            }
+
+            ulTaskNotifyTake(pdTRUE, wait);
         }
     }
 }
 
 
-// Prints event group bits
-void vTask_display_registers(void *args) {
-	 
-    uint32_t statusBits; 
-    uint32_t taskBits;
+// Logs one telemetry line every CONFIG_ESPNOW_TELEMETRY_INTERVAL_MS, or right
+// away when notified. Module details follow at debug level.
+void vTask_telemetry(void *args) {
+
+    telemetry_snapshot_t snap;
+    char line[512];
+    pkt_pool_stats_t pool_stats;
+    recv_ring_stats_t ring_stats;
+    obd_bridge_stats_t bridge_stats;
+    tx_sched_stats_t sched_stats;
+    peer_entry_t peer;
+    value_cache_peer_stats_t cache_stats;
+    value_cache_value_t speed, load;
+    uint32_t last_ms = 0;
+    uint32_t last_tx = 0;
+    uint32_t last_rx = 0;
+    int64_t last_cpu = port_cpu_time_us();
 
 	for (;;) {
-        xEventGroupWaitBits(TASK_REG, TASK_DISPLAY_REGISTERS, pdFALSE, pdFALSE, portMAX_DELAY);
-
-        while (xEventGroupGetBits(TASK_REG) & TASK_DISPLAY_REGISTERS) {
-		    statusBits = xEventGroupGetBits(STATUS_REG);
-            taskBits = xEventGroupGetBits(TASK_REG);
-			
-            ESP_LOGI(TAG_ESP_NOW, "Status & Task Registers: ");
-
-		    for (int i = 0; i < 1; i++) {
-    			if (statusBits & (1 << i)) {
-				    printf("%i", 1);
-				    fflush(stdout); 
-			    } else {
-				    printf("%i", 0);
-				    fflush(stdout);
-			    }
-		    }
-
-            printf("\n");
-
-            for (int i = 0; i < 3; i++) {
-                if (taskBits & (1 << i)) {
-                    printf("%i", 1);
-                    fflush(stdout); 
-                } else {
-                    printf("%i", 0);
-                    fflush(stdout);
-                }
+        xEventGroupWaitBits(TASK_REG, TASK_TELEMETRY, pdFALSE, pdFALSE, portMAX_DELAY);
+
+        while (xEventGroupGetBits(TASK_REG) & TASK_TELEMETRY) {
+            pkt_pool_get_stats(&recv_pool, &pool_stats);
+            recv_ring_get_stats(&recv_ring, &ring_stats);
+            tx_sched_get_stats(&tx_sched, &sched_stats);
+
+            telemetry_gauge_set(TM_GAUGE_POOL_HWM, pool_stats.in_use_hwm);
+            telemetry_gauge_set(TM_GAUGE_RING_HWM, ring_stats.high_water);
+            telemetry_gauge_set(TM_GAUGE_TX_WINDOW, sched_stats.window);
+            telemetry_gauge_set(TM_GAUGE_TX_IN_FLIGHT, sched_stats.in_flight);
+            telemetry_gauge_set(TM_GAUGE_PEERS, peer_table.count);
+
+            telemetry_snapshot(&snap, (uint32_t)(port_time_us() / 1000));
+            telemetry_format(&snap, line, sizeof(line));
+            ESP_LOGI(TAG_TELEMETRY, "status=0x%lx tasks=0x%lx %s", (unsigned long)xEventGroupGetBits(STATUS_REG), (unsigned long)xEventGroupGetBits(TASK_REG), line);
+
+            // rates over the last interval; CPU cost only where the port can measure it
+            uint32_t dt_ms = snap.uptime_ms - last_ms;
+            uint32_t dtx = snap.counters[TM_TX_FRAMES] - last_tx;
+            uint32_t drx = snap.counters[TM_RX_FRAMES] - last_rx;
+            int64_t cpu = port_cpu_time_us();
+            if (dt_ms > 0) {
+                ESP_LOGI(TAG_TELEMETRY, "tx_fps=%lu rx_fps=%lu cpu_us_per_frame=%ld", (unsigned long)(dtx * 1000ULL / dt_ms), (unsigned long)(drx * 1000ULL / dt_ms),
+                         (cpu >= 0 && dtx + drx > 0) ? (long)((cpu - last_cpu) / (dtx + drx)) : -1L);
+            }
+            last_ms = snap.uptime_ms;
+            last_tx = snap.counters[TM_TX_FRAMES];
+            last_rx = snap.counters[TM_RX_FRAMES];
+            last_cpu = cpu;
+
+            ESP_LOGD(TAG_ESP_NOW, "Receive pool: in use %lu, peak %lu, exhausted %lu", (unsigned long)pool_stats.in_use, (unsigned long)pool_stats.in_use_hwm, (unsigned long)pool_stats.exhausted);
+            ESP_LOGD(TAG_ESP_NOW, "Receive ring: depth %lu, peak %lu, dropped %lu", (unsigned long)ring_stats.depth, (unsigned long)ring_stats.high_water, (unsigned long)ring_stats.dropped);
+            ESP_LOGD(TAG_SEND_DATA, "Sent %lu, delivered %lu, failed %lu, retried %lu, dropped %lu, window %u, gap %lu us, success %u.%u%%", (unsigned long)sched_stats.sent, (unsigned long)sched_stats.delivered, (unsigned long)sched_stats.failed, (unsigned long)sched_stats.retried, (unsigned long)sched_stats.dropped, sched_stats.window, (unsigned long)sched_stats.gap_us, sched_stats.success_permille / 10, sched_stats.success_permille % 10);
+            ESP_LOGD(TAG_PEERS, "Peers: %u/%u, evictions %lu, removals %lu", peer_table.count, peer_table.capacity, (unsigned long)peer_table.evictions, (unsigned long)peer_table.removals);
+            for (uint8_t slot = 0; ; slot++) {
+                // copy one entry at a time so the lock is not held while printing
+                xSemaphoreTake(peer_table_lock, portMAX_DELAY);
+                bool more = slot < peer_table.slots;
+                if (more) peer = *peer_table_entry(&peer_table, slot);
+                xSemaphoreGive(peer_table_lock);
+                if (!more) break;
+                if (!peer.in_use) continue;
+
+                ESP_LOGD(TAG_PEERS, "%02X:%02X:%02X:%02X:%02X:%02X rx %lu, tx %lu, delivered %lu, failed %lu", peer.addr[0], peer.addr[1], peer.addr[2], peer.addr[3], peer.addr[4], peer.addr[5], (unsigned long)peer.stats.rx_frames, (unsigned long)peer.stats.tx_frames, (unsigned long)peer.stats.tx_delivered, (unsigned long)peer.stats.tx_failed);
+
+                // the cache is read without the lock
+                value_cache_get_peer_stats(&value_cache, slot, &cache_stats);
+                bool has_speed = value_cache_get(&value_cache, slot, DATA_SPEED, &speed);
+                bool has_load = value_cache_get(&value_cache, slot, DATA_ENGINE_LOAD, &load);
+                ESP_LOGD(TAG_PEERS, "  frames %lu, gaps %lu, duplicates %lu, restarts %lu, speed %ld, load %ld", (unsigned long)cache_stats.frames, (unsigned long)cache_stats.gaps, (unsigned long)cache_stats.duplicates, (unsigned long)cache_stats.restarts, has_speed ? (long)speed.value : -1L, has_load ? (long)load.value : -1L);
+            }
+
+            if (obd_bridge_running) {
+                bridge_stats = obd_bridge.stats;
+                ESP_LOGD(TAG_CAN_BRIDGE, "Requests %lu, responses %lu, timeouts %lu, forwarded %lu, suppressed %lu, coalesced %lu, throttled %lu", (unsigned long)bridge_stats.requests, (unsigned long)bridge_stats.responses, (unsigned long)bridge_stats.timeouts, (unsigned long)bridge_stats.forwarded, (unsigned long)bridge_stats.suppressed, (unsigned long)bridge_stats.coalesced, (unsigned long)bridge_stats.throttled);
+            }
+
+#if CONFIG_IDF_TARGET_LINUX && CONFIG_ESPNOW_SIM_DURATION_S > 0
+            if (snap.uptime_ms / 1000 >= CONFIG_ESPNOW_SIM_DURATION_S) {
+                ESP_LOGW(TAG_TELEMETRY, ">> Info: Simulation finished after %lu ms", (unsigned long)snap.uptime_ms);
+                exit(0);
             }
+#endif
 
-	    	printf("\n");
-	    	fflush(stdout);	
-    		vTaskDelay(pdMS_TO_TICKS(3000));	
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_ESPNOW_TELEMETRY_INTERVAL_MS));
     	}
     }
 }
@@ -243,31 +881,53 @@ void vTask_display_registers(void *args) {
 
 void app_main(void)
 {
+    boot_us = port_time_us();
 
     STATUS_REG = xEventGroupCreate();
     TASK_REG = xEventGroupCreate();
 
-    queue_esp_now_recv = xQueueCreate(1, sizeof(esp_now_data_packet_buff_t));
+    pkt_pool_init(&recv_pool);
+    recv_ring_init(&recv_ring, CONFIG_ESPNOW_RECV_RING_DEPTH);
+    queue_esp_now_send = xQueueCreate(CONFIG_ESPNOW_SEND_QUEUE_DEPTH, sizeof(esp_now_send_item_t));
+    queue_esp_now_status = xQueueCreate(TX_SCHED_SLOTS * 2, sizeof(esp_now_send_status_msg_t));
+
+    tx_sched_config_t sched_cfg = {
+        .max_window = CONFIG_ESPNOW_TX_WINDOW,
+        .max_retries = CONFIG_ESPNOW_TX_MAX_RETRIES,
+        .backoff_us = CONFIG_ESPNOW_TX_BACKOFF_MS * 1000,
+        .min_gap_us = CONFIG_ESPNOW_TX_MIN_GAP_MS * 1000,
+        .max_gap_us = CONFIG_ESPNOW_TX_MAX_GAP_MS * 1000,
+        .ack_timeout_us = TX_ACK_TIMEOUT_MS * 1000,
+    };
+    tx_sched_init(&tx_sched, &sched_cfg);
+
+    peer_table_init(&peer_table, PORT_MAX_PEERS - 1);
+    peer_table_lock = xSemaphoreCreateMutex();
+    value_cache_init(&value_cache);
  
     xTaskCreate(vTask_start_esp_now, "ESP-NOW Start", 4096, NULL, 1, &vTask_start_esp_now_hdl);
-    xTaskCreate(vTask_display_registers, "Display Registers", 2048, NULL, 1, NULL);
-    xTaskCreate(vTask_esp_now_send_data, "Send Data", 4096, NULL, 1, NULL);
-    xTaskCreate(vTask_esp_now_receive, "Receive", 4096, NULL, 2, NULL);
+    xTaskCreate(vTask_telemetry, "Telemetry", 3072, NULL, 1, &vTask_telemetry_hdl);
+    xTaskCreate(vTask_esp_now_send_data, "Send Data", 4096, NULL, 1, &vTask_esp_now_send_data_hdl);
+#if CONFIG_ESPNOW_DATA_SOURCE_RANDOM
+    xTaskCreate(vTask_generate_data, "Generate Data", 2048, NULL, 1, NULL);
+#else
+    can_bridge_start();
+#endif
+    xTaskCreate(vTask_esp_now_receive, "Receive", 4096, NULL, 2, &vTask_esp_now_receive_hdl);
 
     // Start
 
-    xTaskNotifyGive(vTask_start_esp_now_hdl);
-    
-    while ((xEventGroupGetBits(STATUS_REG) & STATUS_ESP_NOW) == 0) {
-        ESP_LOGW(TAG_MAIN, ">> Info: Waiting for ESP-NOW to start!");
-        vTaskDelay(pdMS_TO_TICKS(500)); 
-    }
+    xTaskNotify(vTask_start_esp_now_hdl, RADIO_REQ_START, eSetBits);
+
+    ESP_LOGW(TAG_MAIN, ">> Info: Waiting for ESP-NOW to start!");
+    xEventGroupWaitBits(STATUS_REG, STATUS_ESP_NOW, pdFALSE, pdTRUE, portMAX_DELAY);
     
     ESP_LOGI(TAG_MAIN, ">> Info: Starting to broadcast data"); 
 
     xEventGroupSetBits(TASK_REG, TASK_ESP_NOW_SEND_DATA);
     xEventGroupSetBits(TASK_REG, TASK_ESP_NOW_RECEIVE);
-    xEventGroupSetBits(TASK_REG, TASK_DISPLAY_REGISTERS);
+    xEventGroupSetBits(TASK_REG, TASK_TELEMETRY);
+    xEventGroupSetBits(TASK_REG, TASK_GENERATE_DATA);
 
     ESP_LOGI(TAG_MAIN, ">> Info: End of Main..."); 
 }
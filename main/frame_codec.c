@@ -0,0 +1,75 @@
+#include "frame_codec.h"
+
+
+void frame_enc_begin(frame_enc_t *enc, uint16_t epoch, uint16_t seq) {
+    enc->buf[0] = FRAME_VERSION;
+    enc->buf[1] = 0;
+    enc->buf[2] = (uint8_t)(seq & 0xFF);
+    enc->buf[3] = (uint8_t)(seq >> 8);
+    enc->buf[4] = (uint8_t)(epoch & 0xFF);
+    enc->buf[5] = (uint8_t)(epoch >> 8);
+    enc->len = FRAME_HEADER_LEN;
+    enc->count = 0;
+}
+
+
+bool frame_enc_add(frame_enc_t *enc, const frame_record_t *rec) {
+    uint8_t n = rec->len;
+
+    if (n == 0 || n > FRAME_VALUE_MAX_LEN) return false;
+    if (enc->count == UINT8_MAX || enc->len + 2 + n > FRAME_MAX_LEN) return false;
+
+    uint8_t *p = &enc->buf[enc->len];
+    p[0] = rec->tag;
+    p[1] = n;
+    for (uint8_t i = 0; i < n; i++) {
+        p[2 + i] = (uint8_t)(rec->value >> (8 * (n - 1 - i)));
+    }
+
+    enc->len += 2 + n;
+    enc->count++;
+    return true;
+}
+
+
+uint16_t frame_enc_finish(frame_enc_t *enc) {
+    enc->buf[1] = enc->count;
+    return enc->len;
+}
+
+
+bool frame_dec_begin(frame_dec_t *dec, const uint8_t *buf, uint16_t len) {
+    if (len < FRAME_HEADER_LEN || buf[0] != FRAME_VERSION) return false;
+
+    dec->buf = buf;
+    dec->len = len;
+    dec->pos = FRAME_HEADER_LEN;
+    dec->remaining = buf[1];
+    dec->seq = (uint16_t)(buf[2] | (buf[3] << 8));
+    dec->epoch = (uint16_t)(buf[4] | (buf[5] << 8));
+    return true;
+}
+
+
+bool frame_dec_next(frame_dec_t *dec, frame_record_t *rec) {
+    if (dec->remaining == 0 || dec->pos + 2 > dec->len) return false;
+
+    const uint8_t *p = &dec->buf[dec->pos];
+    uint8_t n = p[1];
+
+    if (n == 0 || n > FRAME_VALUE_MAX_LEN || dec->pos + 2 + n > dec->len) {
+        dec->remaining = 0; // stop at the first bad record
+        return false;
+    }
+
+    rec->tag = p[0];
+    rec->len = n;
+    rec->value = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        rec->value = (rec->value << 8) | p[2 + i];
+    }
+
+    dec->pos += 2 + n;
+    dec->remaining--;
+    return true;
+}
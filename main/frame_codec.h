@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Wire format for coalesced ESP-NOW data frames.
+//
+//   byte 0      FRAME_VERSION
+//   byte 1      number of records
+//   byte 2..3   frame sequence number, little endian
+//   byte 4..5   sender epoch, drawn at boot, little endian
+//   records     tag (1), value length n (1..4), value (n bytes, big endian)
+//
+// Several tagged values share one frame so each value no longer pays the
+// full 802.11 overhead. The epoch changes when the sender reboots, so a
+// receiver tells a restarted sequence from a gap or a repeat.
+
+#define FRAME_VERSION               2
+#define FRAME_MAX_LEN               250     // == ESP_NOW_MAX_DATA_LEN
+#define FRAME_HEADER_LEN            6
+#define FRAME_RECORD_MAX_LEN        6
+#define FRAME_VALUE_MAX_LEN         4
+
+typedef struct {
+    uint8_t tag;
+    uint8_t len;                // significant value bytes, 1..4
+    uint32_t value;
+} frame_record_t;
+
+typedef struct {
+    uint8_t buf[FRAME_MAX_LEN];
+    uint16_t len;
+    uint8_t count;
+} frame_enc_t;
+
+typedef struct {
+    const uint8_t *buf;
+    uint16_t len;
+    uint16_t pos;
+    uint8_t remaining;
+    uint16_t seq;
+    uint16_t epoch;
+} frame_dec_t;
+
+void frame_enc_begin(frame_enc_t *enc, uint16_t epoch, uint16_t seq);
+
+// Returns false when the record does not fit; the frame is left unchanged.
+bool frame_enc_add(frame_enc_t *enc, const frame_record_t *rec);
+
+// Finalises the header and returns the number of bytes to send.
+uint16_t frame_enc_finish(frame_enc_t *enc);
+
+static inline bool frame_enc_empty(const frame_enc_t *enc) {
+    return enc->count == 0;
+}
+
+// Returns false for frames with an unknown version or a truncated header.
+bool frame_dec_begin(frame_dec_t *dec, const uint8_t *buf, uint16_t len);
+
+// Returns false when no records are left or the next one is malformed.
+bool frame_dec_next(frame_dec_t *dec, frame_record_t *rec);
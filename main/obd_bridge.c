@@ -0,0 +1,137 @@
+#include <string.h>
+
+#include "obd_bridge.h"
+
+
+bool obd_bridge_init(obd_bridge_t *bridge, const obd_pid_t *pids, size_t n_pids) {
+    if (n_pids == 0 || n_pids > OBD_BRIDGE_MAX_PIDS) return false;
+
+    memset(bridge, 0, sizeof(*bridge));
+    bridge->pids = pids;
+    bridge->n_pids = n_pids;
+    return true;
+}
+
+
+int obd_bridge_find_pid(const obd_bridge_t *bridge, uint8_t pid) {
+    for (size_t i = 0; i < bridge->n_pids; i++) {
+        if (bridge->pids[i].pid == pid) return (int)i;
+    }
+    return -1;
+}
+
+
+bool obd_bridge_next_request(obd_bridge_t *bridge, uint32_t now_ms, uint32_t send_space, can_frame_t *req) {
+    if (bridge->awaiting) {
+        if (now_ms - bridge->request_ms < OBD_RESPONSE_TIMEOUT_MS) return false;
+        bridge->awaiting = false;
+        bridge->stats.timeouts++;
+    }
+
+    if (send_space < OBD_BRIDGE_MIN_SEND_SPACE) {
+        bridge->stats.throttled++;
+        return false;
+    }
+
+    for (size_t n = 0; n < bridge->n_pids; n++) {
+        size_t i = (bridge->next_poll + n) % bridge->n_pids;
+        const obd_pid_t *pid = &bridge->pids[i];
+        obd_pid_state_t *st = &bridge->state[i];
+
+        if (st->valid && now_ms - st->last_poll_ms < pid->poll_ms) continue;
+
+        memset(req, 0, sizeof(*req));
+        req->id = OBD_REQUEST_ID;
+        req->dlc = CAN_MAX_DLC;
+        req->data[0] = 2; // single frame, two payload bytes
+        req->data[1] = OBD_MODE_CURRENT_DATA;
+        req->data[2] = pid->pid;
+
+        st->last_poll_ms = now_ms;
+        bridge->next_poll = (i + 1) % bridge->n_pids;
+        bridge->awaiting = true;
+        bridge->request_ms = now_ms;
+        bridge->stats.requests++;
+        return true;
+    }
+
+    return false;
+}
+
+
+bool obd_bridge_on_frame(obd_bridge_t *bridge, const can_frame_t *frame, uint32_t now_ms) {
+    if ((frame->id & OBD_RESPONSE_ID_MASK) != OBD_RESPONSE_ID_BASE) return false;
+    if (frame->dlc < 3 || frame->data[1] != OBD_MODE_CURRENT_DATA_REPLY) return false;
+
+    int i = obd_bridge_find_pid(bridge, frame->data[2]);
+    if (i < 0) return false;
+
+    const obd_pid_t *pid = &bridge->pids[i];
+    obd_pid_state_t *st = &bridge->state[i];
+
+    // PCI length counts mode and PID bytes as well as the value
+    if (frame->data[0] < 2 + pid->len || frame->dlc < 3 + pid->len) return false;
+
+    uint32_t value = 0;
+    for (uint8_t b = 0; b < pid->len; b++) {
+        value = (value << 8) | frame->data[3 + b];
+    }
+
+    bridge->awaiting = false;
+    bridge->stats.responses++;
+
+    bool changed = !st->valid || value != st->value;
+    bool stale = pid->refresh_ms != 0 && now_ms - st->last_sent_ms >= pid->refresh_ms;
+
+    st->valid = true;
+    st->value = value;
+    st->value_ms = now_ms;
+
+    if (!changed && !stale) {
+        bridge->stats.suppressed++;
+    } else if (st->pending) {
+        bridge->stats.coalesced++;
+    } else {
+        st->pending = true;
+    }
+    return true;
+}
+
+
+bool obd_bridge_take(obd_bridge_t *bridge, uint32_t now_ms, frame_record_t *rec, uint32_t *value_ms) {
+    for (size_t n = 0; n < bridge->n_pids; n++) {
+        size_t i = (bridge->next_take + n) % bridge->n_pids;
+        const obd_pid_t *pid = &bridge->pids[i];
+        obd_pid_state_t *st = &bridge->state[i];
+
+        if (!st->pending) continue;
+        if (st->last_sent_ms != 0 && now_ms - st->last_sent_ms < pid->poll_ms) continue;
+
+        rec->tag = pid->tag;
+        rec->len = pid->len;
+        rec->value = st->value;
+        // never later than now, a caller may pass a clock it read earlier
+        if (value_ms != NULL) *value_ms = (int32_t)(now_ms - st->value_ms) < 0 ? now_ms : st->value_ms;
+
+        st->pending = false;
+        st->last_sent_ms = now_ms;
+        bridge->next_take = (i + 1) % bridge->n_pids;
+        bridge->stats.forwarded++;
+        return true;
+    }
+
+    return false;
+}
+
+
+void obd_bridge_requeue(obd_bridge_t *bridge, const frame_record_t *rec) {
+    for (size_t i = 0; i < bridge->n_pids; i++) {
+        if (bridge->pids[i].tag != rec->tag) continue;
+
+        // a newer value may already be waiting, keep that one
+        bridge->state[i].pending = true;
+        bridge->state[i].last_sent_ms = 0;
+        bridge->stats.forwarded--;
+        return;
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "can_source.h"
+#include "frame_codec.h"
+
+// OBD-II mode 01 poller that turns PID responses into send records.
+//
+// Requests go out one at a time, round robin over the PIDs that are due.
+// Responses only become records when the value changed or its refresh
+// period ran out, and each PID holds at most one pending record: when the
+// send queue backs up a newer value replaces the older one and no new
+// requests are issued until the queue has room again.
+
+#define OBD_BRIDGE_MAX_PIDS         16
+#define OBD_REQUEST_ID              0x7DF
+#define OBD_RESPONSE_ID_BASE        0x7E8   // ECUs answer on 0x7E8..0x7EF
+#define OBD_RESPONSE_ID_MASK        0x7F8
+#define OBD_MODE_CURRENT_DATA       0x01
+#define OBD_MODE_CURRENT_DATA_REPLY 0x41
+#define OBD_RESPONSE_TIMEOUT_MS     50
+#define OBD_BRIDGE_MIN_SEND_SPACE   2       // queue slots that must be free to poll
+
+typedef struct {
+    uint8_t pid;
+    uint8_t tag;                // record tag on the ESP-NOW side
+    uint8_t len;                // value bytes in the response, 1..4
+    uint16_t poll_ms;           // request interval, also the forwarding rate limit
+    uint16_t refresh_ms;        // resend an unchanged value this often, 0 = never
+} obd_pid_t;
+
+typedef struct {
+    uint32_t requests;
+    uint32_t responses;
+    uint32_t timeouts;
+    uint32_t forwarded;
+    uint32_t suppressed;        // unchanged values not forwarded
+    uint32_t coalesced;         // pending values replaced before they were sent
+    uint32_t throttled;         // polls skipped because the send queue was full
+} obd_bridge_stats_t;
+
+typedef struct {
+    uint32_t value;
+    uint32_t value_ms;          // arrival of the latest value
+    uint32_t last_poll_ms;
+    uint32_t last_sent_ms;
+    bool valid;
+    bool pending;
+} obd_pid_state_t;
+
+typedef struct {
+    const obd_pid_t *pids;
+    size_t n_pids;
+    obd_pid_state_t state[OBD_BRIDGE_MAX_PIDS];
+    size_t next_poll;
+    size_t next_take;
+    bool awaiting;
+    uint32_t request_ms;
+    obd_bridge_stats_t stats;
+} obd_bridge_t;
+
+bool obd_bridge_init(obd_bridge_t *bridge, const obd_pid_t *pids, size_t n_pids);
+
+// Fills req with the next due request. send_space is the free room in the
+// send queue; below OBD_BRIDGE_MIN_SEND_SPACE nothing is requested.
+bool obd_bridge_next_request(obd_bridge_t *bridge, uint32_t now_ms, uint32_t send_space, can_frame_t *req);
+
+// Feeds a received frame. Returns true if it was a response for a known PID.
+bool obd_bridge_on_frame(obd_bridge_t *bridge, const can_frame_t *frame, uint32_t now_ms);
+
+// Takes the next pending record and, if value_ms is not NULL, the time its
+// response arrived, capped at now_ms. Call obd_bridge_requeue if it cannot
+// be sent.
+bool obd_bridge_take(obd_bridge_t *bridge, uint32_t now_ms, frame_record_t *rec, uint32_t *value_ms);
+
+void obd_bridge_requeue(obd_bridge_t *bridge, const frame_record_t *rec);
+
+// Index into the PID table for a PID, or -1.
+int obd_bridge_find_pid(const obd_bridge_t *bridge, uint8_t pid);
@@ -0,0 +1,159 @@
+#include <string.h>
+
+#include "peer_table.h"
+
+#define PEER_BUCKET_MASK            (PEER_TABLE_BUCKETS - 1)
+
+_Static_assert((PEER_TABLE_BUCKETS & PEER_BUCKET_MASK) == 0, "bucket count must be a power of two");
+_Static_assert(PEER_TABLE_BUCKETS > PEER_TABLE_MAX, "hash index needs a free bucket to end probes");
+
+
+// The low three bytes are the NIC part of the MAC and vary the most
+static inline uint32_t peer_hash(const uint8_t *addr) {
+    uint32_t key = ((uint32_t)addr[2] << 24) | ((uint32_t)addr[3] << 16) | ((uint32_t)addr[4] << 8) | addr[5];
+    return (key * 0x9E3779B1u) >> 27 & PEER_BUCKET_MASK;
+}
+
+
+void peer_table_init(peer_table_t *table, uint8_t capacity) {
+    memset(table, 0, sizeof(*table));
+    memset(table->buckets, PEER_NONE, sizeof(table->buckets));
+    table->capacity = capacity > PEER_TABLE_MAX ? PEER_TABLE_MAX : capacity;
+    table->head = PEER_NONE;
+    table->tail = PEER_NONE;
+}
+
+
+static uint32_t peer_bucket_of(const peer_table_t *table, const uint8_t *addr) {
+    uint32_t b = peer_hash(addr);
+
+    while (table->buckets[b] != PEER_NONE &&
+           memcmp(table->entries[table->buckets[b]].addr, addr, PEER_ADDR_LEN) != 0) {
+        b = (b + 1) & PEER_BUCKET_MASK;
+    }
+    return b;
+}
+
+
+uint8_t peer_table_find(const peer_table_t *table, const uint8_t *addr) {
+    return table->buckets[peer_bucket_of(table, addr)];
+}
+
+
+// Linear probing delete: pull later entries of the same probe run back so
+// lookups never stop early on the hole.
+static void peer_bucket_remove(peer_table_t *table, uint32_t hole) {
+    uint32_t b = hole;
+
+    table->buckets[hole] = PEER_NONE;
+
+    for (;;) {
+        b = (b + 1) & PEER_BUCKET_MASK;
+        uint8_t slot = table->buckets[b];
+        if (slot == PEER_NONE) return;
+
+        uint32_t home = peer_hash(table->entries[slot].addr);
+        // move back unless home lies cyclically in (hole, b]
+        if (((b - home) & PEER_BUCKET_MASK) >= ((b - hole) & PEER_BUCKET_MASK)) {
+            table->buckets[hole] = slot;
+            table->buckets[b] = PEER_NONE;
+            hole = b;
+        }
+    }
+}
+
+
+static void peer_lru_unlink(peer_table_t *table, uint8_t slot) {
+    peer_entry_t *e = &table->entries[slot];
+
+    if (e->prev != PEER_NONE) table->entries[e->prev].next = e->next;
+    else table->head = e->next;
+
+    if (e->next != PEER_NONE) table->entries[e->next].prev = e->prev;
+    else table->tail = e->prev;
+}
+
+
+static void peer_lru_push_front(peer_table_t *table, uint8_t slot) {
+    peer_entry_t *e = &table->entries[slot];
+
+    e->prev = PEER_NONE;
+    e->next = table->head;
+    if (table->head != PEER_NONE) table->entries[table->head].prev = slot;
+    table->head = slot;
+    if (table->tail == PEER_NONE) table->tail = slot;
+}
+
+
+uint8_t peer_table_learn(peer_table_t *table, const uint8_t *addr, uint32_t now_ms, peer_learn_result_t *result) {
+    uint32_t b = peer_bucket_of(table, addr);
+    uint8_t slot = table->buckets[b];
+
+    result->added = false;
+    result->evicted = false;
+
+    if (slot != PEER_NONE) {
+        table->entries[slot].last_seen_ms = now_ms;
+        if (table->head != slot) {
+            peer_lru_unlink(table, slot);
+            peer_lru_push_front(table, slot);
+        }
+        return slot;
+    }
+
+    if (table->capacity == 0) return PEER_NONE;
+
+    if (table->count < table->capacity) {
+        // reuse a removed peer's slot before handing out a new one
+        if (table->count < table->slots) {
+            for (slot = 0; table->entries[slot].in_use; slot++) {
+            }
+        } else {
+            slot = table->slots++;
+        }
+        table->count++;
+    } else {
+        slot = table->tail;
+        peer_entry_t *old = &table->entries[slot];
+
+        result->evicted = true;
+        memcpy(result->evicted_addr, old->addr, PEER_ADDR_LEN);
+        peer_lru_unlink(table, slot);
+        peer_bucket_remove(table, peer_bucket_of(table, old->addr));
+        table->evictions++;
+
+        // the hole may have moved the bucket we were going to use
+        b = peer_bucket_of(table, addr);
+    }
+
+    peer_entry_t *e = &table->entries[slot];
+    memset(e, 0, sizeof(*e));
+    memcpy(e->addr, addr, PEER_ADDR_LEN);
+    e->in_use = true;
+    e->first_seen_ms = now_ms;
+    e->last_seen_ms = now_ms;
+
+    table->buckets[b] = slot;
+    peer_lru_push_front(table, slot);
+    result->added = true;
+    return slot;
+}
+
+
+void peer_table_remove(peer_table_t *table, uint8_t slot) {
+    if (slot >= table->slots || !table->entries[slot].in_use) return;
+
+    peer_lru_unlink(table, slot);
+    peer_bucket_remove(table, peer_bucket_of(table, table->entries[slot].addr));
+    table->entries[slot].in_use = false;
+    table->count--;
+    table->removals++;
+}
+
+
+uint8_t peer_table_oldest_idle(const peer_table_t *table, uint32_t now_ms, uint32_t max_idle_ms) {
+    uint8_t slot = table->tail;
+
+    if (slot == PEER_NONE || now_ms - table->entries[slot].last_seen_ms <= max_idle_ms) return PEER_NONE;
+    return slot;
+}
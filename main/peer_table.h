@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// MAC-keyed table of the peers we have heard from.
+//
+// Lookups go through a small open-addressing hash index, so finding a peer
+// costs one hash and usually one probe. Entries sit on an LRU list; when
+// the table is full the least recently heard peer gives up its slot, and
+// peers that went quiet can be aged out from the LRU end. A slot index
+// stays with its peer until that peer is evicted or removed, so other
+// per-peer arrays can be indexed by it. Slots below `slots` may be free;
+// walk them and skip entries that are not in_use.
+//
+// Not thread safe.
+
+#define PEER_TABLE_MAX              20      // == ESP_NOW_MAX_TOTAL_PEER_NUM
+#define PEER_TABLE_BUCKETS          32      // power of two, > PEER_TABLE_MAX
+#define PEER_ADDR_LEN               6       // == ESP_NOW_ETH_ALEN
+#define PEER_NONE                   0xFF
+
+typedef struct {
+    uint32_t rx_frames;
+    uint32_t tx_frames;
+    uint32_t tx_delivered;
+    uint32_t tx_failed;
+} peer_stats_t;
+
+typedef struct {
+    uint8_t addr[PEER_ADDR_LEN];
+    uint8_t prev;               // towards most recently heard
+    uint8_t next;               // towards least recently heard
+    bool in_use;
+    uint8_t tx_fail_streak;     // failed sends since the last delivery
+    uint32_t first_seen_ms;
+    uint32_t last_seen_ms;
+    peer_stats_t stats;
+} peer_entry_t;
+
+typedef struct {
+    bool added;
+    bool evicted;
+    uint8_t evicted_addr[PEER_ADDR_LEN];
+} peer_learn_result_t;
+
+typedef struct {
+    peer_entry_t entries[PEER_TABLE_MAX];
+    uint8_t buckets[PEER_TABLE_BUCKETS];
+    uint8_t capacity;
+    uint8_t count;              // peers in the table
+    uint8_t slots;              // slots handed out so far, the live ones are in_use
+    uint8_t head;               // most recently heard
+    uint8_t tail;               // least recently heard
+    uint32_t evictions;
+    uint32_t removals;
+} peer_table_t;
+
+// capacity is clamped to PEER_TABLE_MAX.
+void peer_table_init(peer_table_t *table, uint8_t capacity);
+
+// Slot of addr or PEER_NONE. Does not touch the LRU order.
+uint8_t peer_table_find(const peer_table_t *table, const uint8_t *addr);
+
+// Records that addr was heard, adding it and evicting the least recently
+// heard peer if needed. Returns the peer's slot.
+uint8_t peer_table_learn(peer_table_t *table, const uint8_t *addr, uint32_t now_ms, peer_learn_result_t *result);
+
+// Drops the peer in slot and frees the slot for the next new peer.
+void peer_table_remove(peer_table_t *table, uint8_t slot);
+
+// Least recently heard peer if it has not been heard for more than
+// max_idle_ms, else PEER_NONE. Remove it and ask again to age out every
+// quiet peer.
+uint8_t peer_table_oldest_idle(const peer_table_t *table, uint32_t now_ms, uint32_t max_idle_ms);
+
+static inline peer_entry_t *peer_table_entry(peer_table_t *table, uint8_t slot) {
+    return &table->entries[slot];
+}
@@ -0,0 +1,56 @@
+#include "pkt_pool.h"
+
+#define PKT_POOL_ALL_FREE   ((uint32_t)(((uint64_t)1 << PKT_POOL_SLOTS) - 1))
+
+_Static_assert(PKT_POOL_SLOTS > 0 && PKT_POOL_SLOTS <= 32, "pool bitmap is 32 bits wide");
+_Static_assert(PKT_POOL_SLOTS < PKT_POOL_INVALID, "slot index must fit below PKT_POOL_INVALID");
+
+
+void pkt_pool_init(pkt_pool_t *pool) {
+    atomic_init(&pool->free_mask, PKT_POOL_ALL_FREE);
+    atomic_init(&pool->in_use_hwm, 0);
+    atomic_init(&pool->exhausted, 0);
+}
+
+
+uint8_t pkt_pool_alloc(pkt_pool_t *pool) {
+    uint32_t mask = atomic_load_explicit(&pool->free_mask, memory_order_relaxed);
+
+    while (mask != 0) {
+        uint32_t idx = (uint32_t)__builtin_ctz(mask);
+        uint32_t claimed = mask & ~((uint32_t)1 << idx);
+
+        // on failure mask is reloaded with the current bitmap
+        if (atomic_compare_exchange_weak_explicit(&pool->free_mask, &mask, claimed,
+                                                  memory_order_acquire, memory_order_relaxed)) {
+            uint32_t in_use = PKT_POOL_SLOTS - (uint32_t)__builtin_popcount(claimed);
+            uint32_t hwm = atomic_load_explicit(&pool->in_use_hwm, memory_order_relaxed);
+
+            while (in_use > hwm &&
+                   !atomic_compare_exchange_weak_explicit(&pool->in_use_hwm, &hwm, in_use,
+                                                          memory_order_relaxed, memory_order_relaxed)) {
+            }
+            return (uint8_t)idx;
+        }
+    }
+
+    atomic_fetch_add_explicit(&pool->exhausted, 1, memory_order_relaxed);
+    return PKT_POOL_INVALID;
+}
+
+
+void pkt_pool_free(pkt_pool_t *pool, uint8_t idx) {
+    if (idx >= PKT_POOL_SLOTS) return;
+
+    // release: the slot contents are done with before the next owner sees the bit
+    atomic_fetch_or_explicit(&pool->free_mask, (uint32_t)1 << idx, memory_order_release);
+}
+
+
+void pkt_pool_get_stats(pkt_pool_t *pool, pkt_pool_stats_t *stats) {
+    uint32_t mask = atomic_load_explicit(&pool->free_mask, memory_order_relaxed);
+
+    stats->in_use = PKT_POOL_SLOTS - (uint32_t)__builtin_popcount(mask);
+    stats->in_use_hwm = atomic_load_explicit(&pool->in_use_hwm, memory_order_relaxed);
+    stats->exhausted = atomic_load_explicit(&pool->exhausted, memory_order_relaxed);
+}
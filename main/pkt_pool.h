@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Fixed pool of receive buffers shared between the ESP-NOW receive callback
+// and the receive task. Slots are claimed and returned through a single
+// atomic bitmap, so alloc/free never block and are safe from the Wi-Fi task.
+// Ownership travels through the receive queue as a slot index.
+
+#define PKT_POOL_ADDR_LEN           6       // == ESP_NOW_ETH_ALEN
+#define PKT_POOL_MTU                250     // == ESP_NOW_MAX_DATA_LEN
+#define PKT_POOL_SLOTS              16      // max 32, one bit per slot
+#define PKT_POOL_INVALID            0xFF
+
+typedef struct {
+	uint8_t source_addr[PKT_POOL_ADDR_LEN];
+	uint8_t destination_addr[PKT_POOL_ADDR_LEN];
+	uint16_t len;
+	uint32_t rx_time_us;        // low bits of the receive timestamp, for latency
+	uint8_t data[PKT_POOL_MTU];
+} esp_now_data_packet_buff_t;
+
+typedef struct {
+    uint32_t in_use;
+    uint32_t in_use_hwm;        // most slots ever held at once
+    uint32_t exhausted;         // allocs refused because every slot was taken
+} pkt_pool_stats_t;
+
+typedef struct {
+    atomic_uint_least32_t free_mask;
+    atomic_uint_least32_t in_use_hwm;
+    atomic_uint_least32_t exhausted;
+    esp_now_data_packet_buff_t slots[PKT_POOL_SLOTS];
+} pkt_pool_t;
+
+void pkt_pool_init(pkt_pool_t *pool);
+
+// Returns a slot index or PKT_POOL_INVALID when the pool is empty.
+uint8_t pkt_pool_alloc(pkt_pool_t *pool);
+
+// Hands a slot back. The caller must own it.
+void pkt_pool_free(pkt_pool_t *pool, uint8_t idx);
+
+void pkt_pool_get_stats(pkt_pool_t *pool, pkt_pool_stats_t *stats);
+
+static inline esp_now_data_packet_buff_t *pkt_pool_slot(pkt_pool_t *pool, uint8_t idx) {
+    return &pool->slots[idx];
+}
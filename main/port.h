@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <esp_err.h>
+
+// Platform layer under the task code: the radio, the clock and the random
+// source. port_esp.c maps it onto ESP-NOW and Wi-Fi; port_sim.c, built for
+// ESP-IDF's linux target, onto a simulated multi-node medium so the same
+// tasks can run and be measured on the host.
+
+#define PORT_ADDR_LEN               6       // == ESP_NOW_ETH_ALEN
+#define PORT_MTU                    250     // == ESP_NOW_MAX_DATA_LEN
+#define PORT_MAX_PEERS              20      // == ESP_NOW_MAX_TOTAL_PEER_NUM
+
+// Both callbacks run in the radio's task (the Wi-Fi task on hardware) and
+// must not block.
+typedef void (*port_recv_cb_t)(const uint8_t *src_addr, const uint8_t *dest_addr, const uint8_t *data, int len);
+typedef void (*port_send_cb_t)(const uint8_t *dest_addr, bool success);
+
+// Brings the radio up on the given channel and registers the callbacks.
+// Bring-up runs in stages and every stage that completed is skipped on the
+// next call, so a failed init can simply be retried and calling it on a
+// running radio only moves it to the given channel.
+esp_err_t port_radio_init(uint8_t channel, port_recv_cb_t recv_cb, port_send_cb_t send_cb);
+
+// Restarts ESP-NOW alone after a radio error, leaving Wi-Fi running. The
+// peer list is lost and has to be registered again.
+esp_err_t port_radio_restart(void);
+
+// Queues a frame. origin_us is when the oldest value in it was produced;
+// the simulation measures end-to-end latency from it, the radio ignores it.
+// ESP_ERR_NOT_FOUND for an unregistered unicast peer, ESP_ERR_NO_MEM when
+// the radio's transmit queue is full.
+esp_err_t port_radio_send(const uint8_t *dest_addr, const uint8_t *data, size_t len, int64_t origin_us);
+
+// Registering a peer that already exists is not an error.
+esp_err_t port_radio_add_peer(const uint8_t *addr);
+esp_err_t port_radio_del_peer(const uint8_t *addr);
+
+// Small blobs that survive a reboot. Load returns ESP_ERR_NOT_FOUND when
+// nothing was saved; *len is the buffer size on entry, the blob size on return.
+esp_err_t port_store_load(const char *key, void *buf, size_t *len);
+esp_err_t port_store_save(const char *key, const void *buf, size_t len);
+
+int64_t port_time_us(void);
+uint32_t port_random(void);
+
+// CPU time spent by the application, or -1 where it cannot be measured.
+int64_t port_cpu_time_us(void);
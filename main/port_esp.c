@@ -0,0 +1,203 @@
+#include <string.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include <esp_now.h>
+#include <esp_event.h>
+#include <esp_netif.h>
+#include <nvs_flash.h>
+#include <nvs.h>
+#include <esp_log.h>
+#include <esp_random.h>
+
+#include "port.h"
+
+_Static_assert(PORT_ADDR_LEN == ESP_NOW_ETH_ALEN, "port address length must match ESP-NOW");
+_Static_assert(PORT_MTU == ESP_NOW_MAX_DATA_LEN, "port MTU must match ESP-NOW");
+_Static_assert(PORT_MAX_PEERS == ESP_NOW_MAX_TOTAL_PEER_NUM, "port peer limit must match ESP-NOW");
+
+static const char *TAG_PORT = "PORT";
+static const char *PORT_NVS_NAMESPACE = "espnow";
+
+// Bring-up stages in order; port_stage is the next one to run
+typedef enum {
+    PORT_STAGE_NVS = 0,
+    PORT_STAGE_NETIF,
+    PORT_STAGE_EVENT_LOOP,
+    PORT_STAGE_WIFI_INIT,
+    PORT_STAGE_WIFI_START,
+    PORT_STAGE_ESPNOW,
+    PORT_STAGE_CALLBACKS,
+    PORT_STAGE_READY,
+} port_stage_t;
+
+static port_stage_t port_stage = PORT_STAGE_NVS;
+static uint8_t port_channel = 0;
+
+static port_recv_cb_t app_recv_cb;
+static port_send_cb_t app_send_cb;
+
+
+static void port_esp_recv_cb(const esp_now_recv_info_t *esp_now_info, const uint8_t *data, int len) {
+    if (!esp_now_info) return;
+
+    app_recv_cb(esp_now_info->src_addr, esp_now_info->des_addr, data, len);
+}
+
+
+static void port_esp_send_cb(const esp_now_send_info_t *tx_info, esp_now_send_status_t status) {
+    if (!tx_info) return;
+
+    app_send_cb(tx_info->des_addr, status == ESP_NOW_SEND_SUCCESS);
+}
+
+
+static esp_err_t port_run_stage(port_stage_t stage) {
+    esp_err_t err;
+
+    switch (stage) {
+    case PORT_STAGE_NVS:
+        err = nvs_flash_init();
+        if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+            ESP_LOGW(TAG_PORT, ">> Warning: NVS partition erased");
+            err = nvs_flash_erase();
+            if (err == ESP_OK) err = nvs_flash_init();
+        }
+        return err;
+
+    case PORT_STAGE_NETIF:
+        return esp_netif_init();
+
+    case PORT_STAGE_EVENT_LOOP:
+        err = esp_event_loop_create_default();
+        return err == ESP_ERR_INVALID_STATE ? ESP_OK : err; // created elsewhere already
+
+    case PORT_STAGE_WIFI_INIT: {
+        wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+        err = esp_wifi_init(&cfg);
+        if (err == ESP_OK) err = esp_wifi_set_mode(WIFI_MODE_STA);
+        return err;
+    }
+
+    case PORT_STAGE_WIFI_START:
+        return esp_wifi_start();
+
+    case PORT_STAGE_ESPNOW:
+        return esp_now_init();
+
+    case PORT_STAGE_CALLBACKS:
+        err = esp_now_register_recv_cb(port_esp_recv_cb);
+        if (err == ESP_OK) err = esp_now_register_send_cb(port_esp_send_cb);
+        return err;
+
+    default:
+        return ESP_OK;
+    }
+}
+
+
+esp_err_t port_radio_init(uint8_t channel, port_recv_cb_t recv_cb, port_send_cb_t send_cb) {
+    esp_err_t err = ESP_OK;
+
+    app_recv_cb = recv_cb;
+    app_send_cb = send_cb;
+
+    while (port_stage < PORT_STAGE_READY) {
+        err = port_run_stage(port_stage);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG_PORT, ">> Error: Radio bring-up stage %d failed: %s", port_stage, esp_err_to_name(err));
+            return err;
+        }
+        port_stage++;
+    }
+
+    if (channel != port_channel) {
+        err = esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+        if (err == ESP_OK) port_channel = channel;
+    }
+    return err;
+}
+
+
+esp_err_t port_radio_restart(void) {
+    if (port_stage > PORT_STAGE_ESPNOW) {
+        esp_err_t err = esp_now_deinit();
+        if (err != ESP_OK && err != ESP_ERR_ESPNOW_NOT_INIT) return err;
+        port_stage = PORT_STAGE_ESPNOW;
+    }
+
+    return port_radio_init(port_channel, app_recv_cb, app_send_cb);
+}
+
+
+esp_err_t port_radio_send(const uint8_t *dest_addr, const uint8_t *data, size_t len, int64_t origin_us) {
+    esp_err_t err = esp_now_send(dest_addr, data, len);
+
+    switch (err) {
+    case ESP_ERR_ESPNOW_NOT_FOUND:  return ESP_ERR_NOT_FOUND;
+    case ESP_ERR_ESPNOW_NO_MEM:     return ESP_ERR_NO_MEM;
+    case ESP_ERR_ESPNOW_NOT_INIT:   return ESP_ERR_INVALID_STATE;
+    default:                        return err;
+    }
+}
+
+
+esp_err_t port_radio_add_peer(const uint8_t *addr) {
+    esp_now_peer_info_t peer = {0};
+    memcpy(peer.peer_addr, addr, ESP_NOW_ETH_ALEN);
+    peer.ifidx = WIFI_IF_STA;
+    peer.channel = 0;
+    peer.encrypt = false;
+
+    esp_err_t err = esp_now_add_peer(&peer);
+    return err == ESP_ERR_ESPNOW_EXIST ? ESP_OK : err;
+}
+
+
+esp_err_t port_radio_del_peer(const uint8_t *addr) {
+    return esp_now_del_peer(addr);
+}
+
+
+esp_err_t port_store_load(const char *key, void *buf, size_t *len) {
+    nvs_handle_t nvs;
+
+    esp_err_t err = nvs_open(PORT_NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (err == ESP_ERR_NVS_NOT_FOUND) return ESP_ERR_NOT_FOUND;
+    if (err != ESP_OK) return err;
+
+    err = nvs_get_blob(nvs, key, buf, len);
+    nvs_close(nvs);
+    return err == ESP_ERR_NVS_NOT_FOUND ? ESP_ERR_NOT_FOUND : err;
+}
+
+
+esp_err_t port_store_save(const char *key, const void *buf, size_t len) {
+    nvs_handle_t nvs;
+
+    esp_err_t err = nvs_open(PORT_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) return err;
+
+    err = nvs_set_blob(nvs, key, buf, len);
+    if (err == ESP_OK) err = nvs_commit(nvs);
+    nvs_close(nvs);
+    return err;
+}
+
+
+int64_t port_time_us(void) {
+    return esp_timer_get_time();
+}
+
+
+uint32_t port_random(void) {
+    return esp_random();
+}
+
+
+int64_t port_cpu_time_us(void) {
+    return -1;
+}
@@ -0,0 +1,416 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+#include <esp_log.h>
+#include <sdkconfig.h>
+
+#include "port.h"
+#include "frame_codec.h"
+#include "telemetry.h"
+
+// Simulated ESP-NOW medium for the linux target.
+//
+// CONFIG_ESPNOW_SIM_NODES peers share one channel with us. Every frame holds
+// the channel for its airtime; a sender that finds the channel busy defers
+// behind it with a random backoff and then risks a collision on top of the
+// configured loss. Unicast frames are acknowledged or not according to those
+// draws, broadcasts are always reported as sent, as on hardware. The peers
+// broadcast a frame of their own every CONFIG_ESPNOW_SIM_NODE_INTERVAL_MS.
+//
+// Everything runs in one medium task standing in for the Wi-Fi task, so the
+// application callbacks are called from a task context just like on the
+// target. Event times are in us but delivery is tick-granular.
+//
+// Bring-up takes CONFIG_ESPNOW_SIM_BRINGUP_MS once, standing in for NVS and
+// Wi-Fi start, and the persistent store is a file per key in the working
+// directory, so a second run behaves like a reboot.
+
+#define SIM_MAX_NODES               8
+#define SIM_MAX_EVENTS              64
+#define SIM_RADIO_QUEUE             8       // frames the radio accepts before it reports ESP_ERR_NO_MEM
+#define SIM_FRAME_OVERHEAD_US       100     // preamble, MAC header, SIFS and ACK
+#define SIM_US_PER_BYTE             8       // 1 Mbit/s, the ESP-NOW default rate
+#define SIM_SLOT_US                 9
+#define SIM_CW                      15
+
+_Static_assert(CONFIG_ESPNOW_SIM_NODES <= SIM_MAX_NODES, "too many simulated nodes");
+
+static const char *TAG_SIM = "SIM";
+
+typedef enum {
+    SIM_EV_APP_RX = 0,          // a node's frame reaches us
+    SIM_EV_NODE_RX,             // our frame reaches a node
+    SIM_EV_SEND_DONE,           // send-complete report for our frame
+    SIM_EV_NODE_TX,             // a node's next broadcast is due
+} sim_event_type_t;
+
+typedef struct {
+    bool used;
+    uint8_t type;
+    uint8_t node;
+    bool success;
+    int64_t at_us;
+    int64_t origin_us;          // production of the oldest value in our frame
+    uint8_t dest[PORT_ADDR_LEN];
+    uint16_t len;
+    uint8_t data[PORT_MTU];
+} sim_event_t;
+
+typedef struct {
+    uint8_t addr[PORT_ADDR_LEN];
+    uint16_t epoch;
+    uint16_t seq;
+} sim_node_t;
+
+static const uint8_t sim_own_addr[PORT_ADDR_LEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x00};
+static const uint8_t sim_broadcast_addr[PORT_ADDR_LEN] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+static struct {
+    SemaphoreHandle_t lock;
+    TaskHandle_t task;
+    port_recv_cb_t recv_cb;
+    port_send_cb_t send_cb;
+    sim_event_t events[SIM_MAX_EVENTS];
+    sim_node_t nodes[SIM_MAX_NODES];
+    uint8_t peers[PORT_MAX_PEERS][PORT_ADDR_LEN];
+    uint8_t n_peers;
+    uint32_t in_radio;
+    int64_t busy_until;
+    uint32_t medium_rng;
+    uint32_t app_rng;
+    bool events_full;
+    volatile int64_t medium_cpu_us;
+} sim;
+
+
+static uint32_t sim_xorshift(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+
+static int64_t sim_clock_us(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+static bool sim_draw_permille(uint32_t permille) {
+    return sim_xorshift(&sim.medium_rng) % 1000 < permille;
+}
+
+
+// Claims the channel for one frame and returns when it ends on air. Sets
+// *contended when the sender had to defer behind another frame.
+static int64_t sim_claim_air(int64_t now, uint16_t len, bool *contended) {
+    int64_t start = now;
+
+    *contended = sim.busy_until > now;
+    if (*contended) {
+        start = sim.busy_until + (int64_t)(sim_xorshift(&sim.medium_rng) % (SIM_CW + 1)) * SIM_SLOT_US;
+    }
+
+    sim.busy_until = start + SIM_FRAME_OVERHEAD_US + (int64_t)len * SIM_US_PER_BYTE;
+    return sim.busy_until;
+}
+
+
+static bool sim_lost(bool contended) {
+    return sim_draw_permille(CONFIG_ESPNOW_SIM_LOSS_PERMILLE) ||
+           (contended && sim_draw_permille(CONFIG_ESPNOW_SIM_COLLISION_PERMILLE));
+}
+
+
+static int64_t sim_delay_us(void) {
+    return CONFIG_ESPNOW_SIM_DELAY_US + sim_xorshift(&sim.medium_rng) % (CONFIG_ESPNOW_SIM_JITTER_US + 1);
+}
+
+
+// Lock held. Returns the new event, or NULL when the table is full.
+static sim_event_t *sim_schedule(uint8_t type, int64_t at_us) {
+    for (int i = 0; i < SIM_MAX_EVENTS; i++) {
+        sim_event_t *ev = &sim.events[i];
+
+        if (!ev->used) {
+            memset(ev, 0, offsetof(sim_event_t, data));
+            ev->used = true;
+            ev->type = type;
+            ev->at_us = at_us;
+            return ev;
+        }
+    }
+
+    if (!sim.events_full) ESP_LOGW(TAG_SIM, ">> Warning: Event table full, simulated frames are being lost");
+    sim.events_full = true;
+    return NULL;
+}
+
+
+static int sim_peer_index(const uint8_t *addr) {
+    for (int i = 0; i < sim.n_peers; i++) {
+        if (memcmp(sim.peers[i], addr, PORT_ADDR_LEN) == 0) return i;
+    }
+    return -1;
+}
+
+
+// Lock held. Puts the next broadcast of a node on air.
+static void sim_node_transmit(uint8_t node, int64_t now) {
+    sim_node_t *n = &sim.nodes[node];
+    frame_enc_t enc;
+    frame_record_t rec = { .len = 1 };
+    bool contended;
+
+    frame_enc_begin(&enc, n->epoch, n->seq++);
+    rec.tag = 0x41;
+    rec.value = sim_xorshift(&sim.medium_rng) & 0xFF;
+    frame_enc_add(&enc, &rec);
+    rec.tag = 0x04;
+    rec.value = sim_xorshift(&sim.medium_rng) & 0xFF;
+    frame_enc_add(&enc, &rec);
+    uint16_t len = frame_enc_finish(&enc);
+
+    int64_t end = sim_claim_air(now, len, &contended);
+    if (!sim_lost(contended)) {
+        sim_event_t *ev = sim_schedule(SIM_EV_APP_RX, end + sim_delay_us());
+        if (ev) {
+            ev->node = node;
+            ev->len = len;
+            memcpy(ev->data, enc.buf, len);
+        }
+    }
+
+    int64_t interval = CONFIG_ESPNOW_SIM_NODE_INTERVAL_MS * 1000LL;
+    sim_event_t *next = sim_schedule(SIM_EV_NODE_TX, now + interval / 2 + sim_xorshift(&sim.medium_rng) % interval);
+    if (next) next->node = node;
+}
+
+
+static void vTask_sim_medium(void *args) {
+    sim_event_t ev;
+
+    for (;;) {
+        int64_t cpu_start = sim_clock_us(CLOCK_THREAD_CPUTIME_ID);
+        int64_t now = port_time_us();
+        int64_t next_us = INT64_MAX;
+        int due = -1;
+
+        xSemaphoreTake(sim.lock, portMAX_DELAY);
+        for (int i = 0; i < SIM_MAX_EVENTS; i++) {
+            if (!sim.events[i].used) continue;
+            if (sim.events[i].at_us < next_us) {
+                next_us = sim.events[i].at_us;
+                due = i;
+            }
+        }
+
+        if (due >= 0 && next_us <= now) {
+            ev = sim.events[due];
+            sim.events[due].used = false;
+
+            if (ev.type == SIM_EV_NODE_TX) sim_node_transmit(ev.node, now);
+            if (ev.type == SIM_EV_SEND_DONE) sim.in_radio--;
+        } else {
+            due = -1;
+        }
+        xSemaphoreGive(sim.lock);
+
+        // the callbacks are application time
+        sim.medium_cpu_us += sim_clock_us(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+
+        // callbacks run unlocked, they may call back into the port
+        if (due >= 0) {
+            if (ev.type == SIM_EV_APP_RX) sim.recv_cb(sim.nodes[ev.node].addr, sim_broadcast_addr, ev.data, ev.len);
+            if (ev.type == SIM_EV_NODE_RX) telemetry_record_us(TM_HIST_E2E_LATENCY, (uint32_t)(ev.at_us - ev.origin_us));
+            if (ev.type == SIM_EV_SEND_DONE) sim.send_cb(ev.dest, ev.success);
+        }
+
+        if (due < 0) {
+            TickType_t wait = portMAX_DELAY;
+            if (next_us != INT64_MAX) {
+                wait = pdMS_TO_TICKS((next_us - now + 999) / 1000);
+                if (wait == 0) wait = 1;
+            }
+            ulTaskNotifyTake(pdTRUE, wait);
+        }
+    }
+}
+
+
+esp_err_t port_radio_init(uint8_t channel, port_recv_cb_t recv_cb, port_send_cb_t send_cb) {
+    sim.recv_cb = recv_cb;
+    sim.send_cb = send_cb;
+    if (sim.task) return ESP_OK;
+
+    vTaskDelay(pdMS_TO_TICKS(CONFIG_ESPNOW_SIM_BRINGUP_MS));
+    sim.medium_rng = CONFIG_ESPNOW_SIM_SEED ? CONFIG_ESPNOW_SIM_SEED : 1;
+    sim.lock = xSemaphoreCreateMutex();
+    if (!sim.lock) return ESP_ERR_NO_MEM;
+
+    int64_t now = port_time_us();
+    for (uint8_t i = 0; i < CONFIG_ESPNOW_SIM_NODES; i++) {
+        memcpy(sim.nodes[i].addr, sim_own_addr, PORT_ADDR_LEN);
+        sim.nodes[i].addr[PORT_ADDR_LEN - 1] = i + 1;
+        sim.nodes[i].epoch = (uint16_t)sim_xorshift(&sim.medium_rng);
+
+        sim_event_t *ev = sim_schedule(SIM_EV_NODE_TX, now + sim_xorshift(&sim.medium_rng) % (CONFIG_ESPNOW_SIM_NODE_INTERVAL_MS * 1000LL));
+        if (ev) ev->node = i;
+    }
+
+    if (xTaskCreate(vTask_sim_medium, "Sim Medium", 4096, NULL, configMAX_PRIORITIES - 2, &sim.task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGW(TAG_SIM, ">> Info: Simulated channel %u, %u nodes, loss %u permille, delay %u us", channel, CONFIG_ESPNOW_SIM_NODES,
+             CONFIG_ESPNOW_SIM_LOSS_PERMILLE, CONFIG_ESPNOW_SIM_DELAY_US);
+    return ESP_OK;
+}
+
+
+// ESP-NOW forgets its peers on deinit; the channel keeps running.
+esp_err_t port_radio_restart(void) {
+    if (!sim.task) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(sim.lock, portMAX_DELAY);
+    sim.n_peers = 0;
+    xSemaphoreGive(sim.lock);
+    return ESP_OK;
+}
+
+
+esp_err_t port_radio_send(const uint8_t *dest_addr, const uint8_t *data, size_t len, int64_t origin_us) {
+    bool broadcast = memcmp(dest_addr, sim_broadcast_addr, PORT_ADDR_LEN) == 0;
+    bool delivered = false;
+    bool contended;
+
+    if (!data || len == 0 || len > PORT_MTU) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(sim.lock, portMAX_DELAY);
+    if (sim_peer_index(dest_addr) < 0) {
+        xSemaphoreGive(sim.lock);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (sim.in_radio >= SIM_RADIO_QUEUE) {
+        xSemaphoreGive(sim.lock);
+        return ESP_ERR_NO_MEM;
+    }
+
+    int64_t now = port_time_us();
+    int64_t end = sim_claim_air(now, (uint16_t)len, &contended);
+
+    for (int i = 0; i < CONFIG_ESPNOW_SIM_NODES; i++) {
+        if (!broadcast && memcmp(sim.nodes[i].addr, dest_addr, PORT_ADDR_LEN) != 0) continue;
+        if (sim_lost(contended)) continue;
+
+        sim_event_t *ev = sim_schedule(SIM_EV_NODE_RX, end + sim_delay_us());
+        if (ev) {
+            ev->node = i;
+            ev->origin_us = origin_us;
+        }
+        delivered = true;
+    }
+
+    sim_event_t *done = sim_schedule(SIM_EV_SEND_DONE, end);
+    if (done) {
+        done->success = broadcast || delivered;
+        memcpy(done->dest, dest_addr, PORT_ADDR_LEN);
+        sim.in_radio++;
+    }
+    xSemaphoreGive(sim.lock);
+
+    xTaskNotifyGive(sim.task);
+    return done ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+
+esp_err_t port_radio_add_peer(const uint8_t *addr) {
+    esp_err_t err = ESP_OK;
+
+    xSemaphoreTake(sim.lock, portMAX_DELAY);
+    if (sim_peer_index(addr) < 0) {
+        if (sim.n_peers < PORT_MAX_PEERS) {
+            memcpy(sim.peers[sim.n_peers++], addr, PORT_ADDR_LEN);
+        } else {
+            err = ESP_ERR_NO_MEM;
+        }
+    }
+    xSemaphoreGive(sim.lock);
+    return err;
+}
+
+
+esp_err_t port_radio_del_peer(const uint8_t *addr) {
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+
+    xSemaphoreTake(sim.lock, portMAX_DELAY);
+    int i = sim_peer_index(addr);
+    if (i >= 0) {
+        memcpy(sim.peers[i], sim.peers[--sim.n_peers], PORT_ADDR_LEN);
+        err = ESP_OK;
+    }
+    xSemaphoreGive(sim.lock);
+    return err;
+}
+
+
+static void sim_store_path(const char *key, char *path, size_t len) {
+    snprintf(path, len, "espnow_%s.bin", key);
+}
+
+
+esp_err_t port_store_load(const char *key, void *buf, size_t *len) {
+    char path[64];
+    sim_store_path(key, path, sizeof(path));
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return ESP_ERR_NOT_FOUND;
+
+    *len = fread(buf, 1, *len, f);
+    fclose(f);
+    return ESP_OK;
+}
+
+
+esp_err_t port_store_save(const char *key, const void *buf, size_t len) {
+    char path[64];
+    sim_store_path(key, path, sizeof(path));
+
+    FILE *f = fopen(path, "wb");
+    if (!f) return ESP_FAIL;
+
+    bool ok = fwrite(buf, 1, len, f) == len;
+    return fclose(f) == 0 && ok ? ESP_OK : ESP_FAIL;
+}
+
+
+int64_t port_time_us(void) {
+    static int64_t start_us = 0;
+    int64_t now = sim_clock_us(CLOCK_MONOTONIC);
+
+    if (start_us == 0) start_us = now;
+    return now - start_us;
+}
+
+
+// Seeded apart from the medium so the application's draws do not shift the
+// simulated channel between runs.
+uint32_t port_random(void) {
+    if (sim.app_rng == 0) sim.app_rng = (CONFIG_ESPNOW_SIM_SEED * 2654435761u) | 1;
+    return sim_xorshift(&sim.app_rng);
+}
+
+
+// Process CPU time less the medium task, i.e. what the application itself
+// and the FreeRTOS simulator spent.
+int64_t port_cpu_time_us(void) {
+    return sim_clock_us(CLOCK_PROCESS_CPUTIME_ID) - sim.medium_cpu_us;
+}
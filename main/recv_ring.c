@@ -0,0 +1,59 @@
+#include "recv_ring.h"
+
+
+bool recv_ring_init(recv_ring_t *ring, uint32_t depth) {
+    if (depth == 0 || depth > RECV_RING_MAX_DEPTH || (depth & (depth - 1)) != 0) return false;
+
+    ring->mask = depth - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->high_water, 0);
+    atomic_init(&ring->dropped, 0);
+    return true;
+}
+
+
+bool recv_ring_push(recv_ring_t *ring, uint8_t entry) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    uint32_t used = head - tail;
+
+    if (used > ring->mask) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+
+    ring->entries[head & ring->mask] = entry;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    // only the producer writes high_water, a plain store is enough
+    if (used + 1 > atomic_load_explicit(&ring->high_water, memory_order_relaxed)) {
+        atomic_store_explicit(&ring->high_water, used + 1, memory_order_relaxed);
+    }
+    return true;
+}
+
+
+uint32_t recv_ring_pop_batch(recv_ring_t *ring, uint8_t *out, uint32_t max) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t n = head - tail;
+
+    if (n > max) n = max;
+
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = ring->entries[(tail + i) & ring->mask];
+    }
+
+    if (n > 0) {
+        atomic_store_explicit(&ring->tail, tail + n, memory_order_release);
+    }
+    return n;
+}
+
+
+void recv_ring_get_stats(recv_ring_t *ring, recv_ring_stats_t *stats) {
+    stats->depth = ring->mask + 1;
+    stats->high_water = atomic_load_explicit(&ring->high_water, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// Single-producer/single-consumer ring of packet pool slot indices.
+// The ESP-NOW receive callback is the only producer and the receive task
+// the only consumer, so head and tail each have exactly one writer and no
+// lock is needed. The consumer drains several entries per wake-up.
+
+#define RECV_RING_MAX_DEPTH         32
+
+typedef struct {
+    uint32_t depth;
+    uint32_t high_water;        // most entries ever waiting at once
+    uint32_t dropped;           // pushes refused because the ring was full
+} recv_ring_stats_t;
+
+typedef struct {
+    atomic_uint_least32_t head;         // written by the producer only
+    atomic_uint_least32_t tail;         // written by the consumer only
+    atomic_uint_least32_t high_water;
+    atomic_uint_least32_t dropped;
+    uint32_t mask;
+    uint8_t entries[RECV_RING_MAX_DEPTH];
+} recv_ring_t;
+
+// depth must be a power of two no larger than RECV_RING_MAX_DEPTH.
+bool recv_ring_init(recv_ring_t *ring, uint32_t depth);
+
+// Producer side. Returns false and counts a drop when the ring is full.
+bool recv_ring_push(recv_ring_t *ring, uint8_t entry);
+
+// Consumer side. Moves up to max entries into out and returns how many.
+uint32_t recv_ring_pop_batch(recv_ring_t *ring, uint8_t *out, uint32_t max);
+
+void recv_ring_get_stats(recv_ring_t *ring, recv_ring_stats_t *stats);
@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "telemetry.h"
+
+telemetry_core_t telemetry_cores[TELEMETRY_CORES];
+atomic_uint_least32_t telemetry_gauges[TM_GAUGE_COUNT];
+
+static const char *const counter_names[TM_COUNTER_COUNT] = {
+    [TM_RX_FRAMES]          = "rx",
+    [TM_RX_DROPPED]         = "rx_drop",
+    [TM_RX_POOL_EMPTY]      = "rx_pool_empty",
+    [TM_RX_OVERSIZE]        = "rx_oversize",
+    [TM_RX_BAD_FRAMES]      = "rx_bad",
+    [TM_RX_RECORDS]         = "rx_rec",
+    [TM_RX_GAPS]            = "rx_gap",
+    [TM_RX_DUPLICATES]      = "rx_dup",
+    [TM_TX_RECORDS]         = "tx_rec",
+    [TM_TX_RECORDS_DROPPED] = "tx_rec_drop",
+    [TM_TX_FRAMES]          = "tx",
+    [TM_TX_DELIVERED]       = "tx_ok",
+    [TM_TX_FAILED]          = "tx_fail",
+    [TM_RADIO_RESTARTS]     = "radio_restart",
+};
+
+static const char *const gauge_names[TM_GAUGE_COUNT] = {
+    [TM_GAUGE_POOL_HWM]       = "pool_hwm",
+    [TM_GAUGE_RING_HWM]       = "ring_hwm",
+    [TM_GAUGE_SEND_QUEUE_HWM] = "sendq_hwm",
+    [TM_GAUGE_TX_WINDOW]      = "win",
+    [TM_GAUGE_TX_IN_FLIGHT]   = "inflight",
+    [TM_GAUGE_PEERS]          = "peers",
+    [TM_GAUGE_READY_MS]       = "ready_ms",
+    [TM_GAUGE_FIRST_TX_MS]    = "first_tx_ms",
+};
+
+static const char *const hist_names[TM_HIST_COUNT] = {
+    [TM_HIST_RX_LATENCY]     = "rx_lat",
+    [TM_HIST_TX_ACK_LATENCY] = "ack_lat",
+    [TM_HIST_E2E_LATENCY]    = "e2e_lat",
+};
+
+
+void telemetry_snapshot(telemetry_snapshot_t *snap, uint32_t uptime_ms) {
+    memset(snap, 0, sizeof(*snap));
+    snap->version = TELEMETRY_SNAPSHOT_VERSION;
+    snap->uptime_ms = uptime_ms;
+
+    for (int c = 0; c < TELEMETRY_CORES; c++) {
+        for (int i = 0; i < TM_COUNTER_COUNT; i++) {
+            snap->counters[i] += atomic_load_explicit(&telemetry_cores[c].counters[i], memory_order_relaxed);
+        }
+        for (int h = 0; h < TM_HIST_COUNT; h++) {
+            for (int b = 0; b < TELEMETRY_HIST_BUCKETS; b++) {
+                snap->hist[h][b] += atomic_load_explicit(&telemetry_cores[c].hist[h][b], memory_order_relaxed);
+            }
+        }
+    }
+
+    for (int i = 0; i < TM_GAUGE_COUNT; i++) {
+        snap->gauges[i] = atomic_load_explicit(&telemetry_gauges[i], memory_order_relaxed);
+    }
+}
+
+
+uint32_t telemetry_percentile_us(const telemetry_snapshot_t *snap, telemetry_hist_t id, uint32_t pct) {
+    uint64_t total = 0;
+    uint64_t seen = 0;
+
+    for (int b = 0; b < TELEMETRY_HIST_BUCKETS; b++) total += snap->hist[id][b];
+    if (total == 0) return 0;
+
+    // rank of the sample at pct, rounded up so p100 is the last one
+    uint64_t rank = (total * pct + 99) / 100;
+    if (rank == 0) rank = 1;
+
+    for (int b = 0; b < TELEMETRY_HIST_BUCKETS; b++) {
+        seen += snap->hist[id][b];
+        if (seen >= rank) return b == 0 ? 0 : (uint32_t)1 << b;
+    }
+    return (uint32_t)1 << (TELEMETRY_HIST_BUCKETS - 1);
+}
+
+
+int telemetry_format(const telemetry_snapshot_t *snap, char *buf, size_t len) {
+    size_t pos = 0;
+    int n = snprintf(buf, len, "t=%lu", (unsigned long)snap->uptime_ms);
+
+#define APPEND(...)                                                         \
+    do {                                                                    \
+        if (n < 0) return n;                                                \
+        pos += (size_t)n;                                                   \
+        n = snprintf(pos < len ? buf + pos : NULL, pos < len ? len - pos : 0, __VA_ARGS__); \
+    } while (0)
+
+    for (int i = 0; i < TM_COUNTER_COUNT; i++) {
+        APPEND(" %s=%lu", counter_names[i], (unsigned long)snap->counters[i]);
+    }
+    for (int i = 0; i < TM_GAUGE_COUNT; i++) {
+        APPEND(" %s=%lu", gauge_names[i], (unsigned long)snap->gauges[i]);
+    }
+    for (int h = 0; h < TM_HIST_COUNT; h++) {
+        APPEND(" %s_p50=%lu %s_p99=%lu", hist_names[h], (unsigned long)telemetry_percentile_us(snap, h, 50),
+               hist_names[h], (unsigned long)telemetry_percentile_us(snap, h, 99));
+    }
+
+#undef APPEND
+
+    if (n < 0) return n;
+    return (int)(pos + (size_t)n);
+}
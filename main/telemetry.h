@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#ifdef ESP_PLATFORM
+#include <sdkconfig.h>
+#endif
+
+// Counters, gauges and latency histograms for the hot paths.
+//
+// Counters and histogram buckets are kept per core and bumped with a relaxed
+// atomic add, so an increment never contends with the other core and costs
+// a handful of instructions. Gauges are single values that are either set
+// or raised to a new maximum. Everything is summed on demand into one
+// snapshot that can be copied out as is or printed as a single line.
+
+#if defined(ESP_PLATFORM) && !CONFIG_IDF_TARGET_LINUX
+#include <esp_cpu.h>
+#define TELEMETRY_CORE_ID()         ((uint32_t)esp_cpu_get_core_id())
+#else
+#define TELEMETRY_CORE_ID()         0u
+#endif
+
+#define TELEMETRY_CORES             2
+#define TELEMETRY_HIST_BUCKETS      24      // bucket n holds [2^(n-1), 2^n) us, the last one everything above
+#define TELEMETRY_SNAPSHOT_VERSION  6
+
+typedef enum {
+    TM_RX_FRAMES = 0,           // frames taken by the receive callback
+    TM_RX_DROPPED,              // frames lost to a full ring
+    TM_RX_POOL_EMPTY,           // frames lost because no pool slot was free
+    TM_RX_OVERSIZE,             // frames empty or too long for a pool slot
+    TM_RX_BAD_FRAMES,           // frames the decoder rejected
+    TM_RX_RECORDS,
+    TM_RX_GAPS,                 // frames missed, from the senders' sequence numbers
+    TM_RX_DUPLICATES,           // repeated or late frames, not applied
+    TM_TX_RECORDS,              // records packed into frames
+    TM_TX_RECORDS_DROPPED,      // records lost to a full send queue
+    TM_TX_FRAMES,               // frames accepted by esp_now_send
+    TM_TX_DELIVERED,
+    TM_TX_FAILED,               // failed sends and negative reports
+    TM_RADIO_RESTARTS,
+    TM_COUNTER_COUNT
+} telemetry_counter_t;
+
+typedef enum {
+    TM_GAUGE_POOL_HWM = 0,
+    TM_GAUGE_RING_HWM,
+    TM_GAUGE_SEND_QUEUE_HWM,
+    TM_GAUGE_TX_WINDOW,
+    TM_GAUGE_TX_IN_FLIGHT,
+    TM_GAUGE_PEERS,
+    TM_GAUGE_READY_MS,          // start to radio ready
+    TM_GAUGE_FIRST_TX_MS,       // start to first delivered frame
+    TM_GAUGE_COUNT
+} telemetry_gauge_t;
+
+typedef enum {
+    TM_HIST_RX_LATENCY = 0,     // receive callback to receive task
+    TM_HIST_TX_ACK_LATENCY,     // esp_now_send to send-complete report
+    TM_HIST_E2E_LATENCY,        // production of a frame's oldest value to its arrival at a peer; only the host simulation sees both ends
+    TM_HIST_COUNT
+} telemetry_hist_t;
+
+typedef struct {
+    uint8_t version;
+    uint8_t reserved[3];
+    uint32_t uptime_ms;
+    uint32_t counters[TM_COUNTER_COUNT];
+    uint32_t gauges[TM_GAUGE_COUNT];
+    uint32_t hist[TM_HIST_COUNT][TELEMETRY_HIST_BUCKETS];
+} telemetry_snapshot_t;
+
+typedef struct {
+    atomic_uint_least32_t counters[TM_COUNTER_COUNT];
+    atomic_uint_least32_t hist[TM_HIST_COUNT][TELEMETRY_HIST_BUCKETS];
+} __attribute__((aligned(32))) telemetry_core_t;
+
+extern telemetry_core_t telemetry_cores[TELEMETRY_CORES];
+extern atomic_uint_least32_t telemetry_gauges[TM_GAUGE_COUNT];
+
+static inline void telemetry_add(telemetry_counter_t id, uint32_t n) {
+    atomic_fetch_add_explicit(&telemetry_cores[TELEMETRY_CORE_ID()].counters[id], n, memory_order_relaxed);
+}
+
+static inline void telemetry_inc(telemetry_counter_t id) {
+    telemetry_add(id, 1);
+}
+
+static inline void telemetry_gauge_set(telemetry_gauge_t id, uint32_t value) {
+    atomic_store_explicit(&telemetry_gauges[id], value, memory_order_relaxed);
+}
+
+static inline void telemetry_gauge_max(telemetry_gauge_t id, uint32_t value) {
+    uint32_t cur = atomic_load_explicit(&telemetry_gauges[id], memory_order_relaxed);
+
+    while (value > cur &&
+           !atomic_compare_exchange_weak_explicit(&telemetry_gauges[id], &cur, value,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+static inline uint32_t telemetry_hist_bucket(uint32_t us) {
+    uint32_t b = us == 0 ? 0 : 32 - (uint32_t)__builtin_clz(us);
+    return b < TELEMETRY_HIST_BUCKETS ? b : TELEMETRY_HIST_BUCKETS - 1;
+}
+
+static inline void telemetry_record_us(telemetry_hist_t id, uint32_t us) {
+    atomic_fetch_add_explicit(&telemetry_cores[TELEMETRY_CORE_ID()].hist[id][telemetry_hist_bucket(us)], 1, memory_order_relaxed);
+}
+
+// Sums all cores. Counters keep running; take differences between snapshots
+// for rates.
+void telemetry_snapshot(telemetry_snapshot_t *snap, uint32_t uptime_ms);
+
+// Upper bound in us of the bucket holding the given percentile (0..100),
+// or 0 for an empty histogram.
+uint32_t telemetry_percentile_us(const telemetry_snapshot_t *snap, telemetry_hist_t id, uint32_t pct);
+
+// Single-line "key=value" rendering. Returns the length as snprintf does.
+int telemetry_format(const telemetry_snapshot_t *snap, char *buf, size_t len);
@@ -0,0 +1,264 @@
+#include <string.h>
+
+#include "tx_sched.h"
+
+#define TX_SCHED_EWMA_SHIFT         3       // success average weight 1/8
+
+
+void tx_sched_init(tx_sched_t *sched, const tx_sched_config_t *cfg) {
+    memset(sched, 0, sizeof(*sched));
+    sched->cfg = *cfg;
+    if (sched->cfg.max_window == 0) sched->cfg.max_window = 1;
+    if (sched->cfg.max_gap_us < sched->cfg.min_gap_us) sched->cfg.max_gap_us = sched->cfg.min_gap_us;
+
+    // start cautiously and let successes open things up
+    sched->window = 1;
+    sched->gap_us = sched->cfg.max_gap_us / 4 > sched->cfg.min_gap_us ? sched->cfg.max_gap_us / 4 : sched->cfg.min_gap_us;
+    sched->stats.success_permille = 1000;
+    sched->channel_permille = 1000;
+}
+
+
+uint32_t tx_sched_free_slots(const tx_sched_t *sched) {
+    uint32_t n = 0;
+
+    for (int i = 0; i < TX_SCHED_SLOTS; i++) {
+        if (sched->slots[i].state == TX_SLOT_FREE) n++;
+    }
+    return n;
+}
+
+
+bool tx_sched_submit(tx_sched_t *sched, const uint8_t *dest, const uint8_t *buf, uint16_t len, uint64_t origin_us, uint64_t now_us) {
+    if (len > TX_SCHED_MTU) return false;
+
+    for (int i = 0; i < TX_SCHED_SLOTS; i++) {
+        tx_frame_t *f = &sched->slots[i];
+        if (f->state != TX_SLOT_FREE) continue;
+
+        memcpy(f->dest, dest, TX_SCHED_ADDR_LEN);
+        memcpy(f->buf, buf, len);
+        f->len = len;
+        f->attempts = 0;
+        f->order = sched->next_order++; // keeps submission order among queued frames
+        f->ready_us = now_us;
+        f->origin_us = origin_us;
+        f->state = TX_SLOT_QUEUED;
+        sched->stats.submitted++;
+        return true;
+    }
+
+    sched->stats.rejected++;
+    return false;
+}
+
+
+// Tracks failure streaks per address. Returns true when this failure is
+// the peer's own problem: it failed several times in a row while frames to
+// others were delivered and nobody else failed.
+static bool tx_sched_dest_isolated(tx_sched_t *sched, const uint8_t *dest, bool success) {
+    tx_dest_t *own = NULL;
+    tx_dest_t *free = NULL;
+
+    for (int i = 0; i < TX_SCHED_DESTS; i++) {
+        tx_dest_t *d = &sched->dests[i];
+
+        if (d->failures == 0) {
+            if (free == NULL) free = d;
+        } else if (memcmp(d->dest, dest, TX_SCHED_ADDR_LEN) == 0) {
+            own = d;
+        } else if (!success) {
+            d->shared = true;
+        }
+    }
+
+    if (success) {
+        if (own != NULL) own->failures = 0;
+        return false;
+    }
+
+    if (own == NULL) {
+        // a full table only means the failure is charged to the channel
+        if (free != NULL) {
+            memcpy(free->dest, dest, TX_SCHED_ADDR_LEN);
+            free->failures = 1;
+            free->shared = false;
+            free->delivered_at = sched->stats.delivered;
+        }
+        return false;
+    }
+
+    if (own->failures < UINT8_MAX) own->failures++;
+    return own->failures > TX_SCHED_DEST_FAILURES && !own->shared && sched->stats.delivered != own->delivered_at;
+}
+
+
+static uint16_t tx_sched_average(uint16_t avg, bool success) {
+    uint32_t sample = success ? 1000 : 0;
+
+    return (uint16_t)(avg - (avg >> TX_SCHED_EWMA_SHIFT) + (sample >> TX_SCHED_EWMA_SHIFT));
+}
+
+
+// The narrowest gap the channel's success average allows: min_gap_us at
+// full success, four times that at half, max_gap_us when nothing arrives
+static uint32_t tx_sched_gap_floor(const tx_sched_t *sched) {
+    uint64_t permille = sched->channel_permille;
+
+    if (permille == 0) return sched->cfg.max_gap_us;
+
+    uint64_t gap = (uint64_t)sched->cfg.min_gap_us * 1000 * 1000 / (permille * permille);
+    return gap > sched->cfg.max_gap_us ? sched->cfg.max_gap_us : (uint32_t)gap;
+}
+
+
+static uint8_t tx_sched_window_limit(const tx_sched_t *sched) {
+    uint32_t limit = (uint32_t)sched->cfg.max_window * sched->channel_permille / 1000;
+
+    return limit > 1 ? (uint8_t)limit : 1;
+}
+
+
+static void tx_sched_record(tx_sched_t *sched, const uint8_t *dest, bool success) {
+    sched->stats.success_permille = tx_sched_average(sched->stats.success_permille, success);
+
+    if (tx_sched_dest_isolated(sched, dest, success)) {
+        sched->stats.isolated++;
+        return;
+    }
+
+    sched->channel_permille = tx_sched_average(sched->channel_permille, success);
+
+    uint32_t gap_floor = tx_sched_gap_floor(sched);
+    uint8_t window_limit = tx_sched_window_limit(sched);
+
+    if (success) {
+        sched->gap_us -= sched->gap_us / 8;
+        if (sched->gap_us < gap_floor) sched->gap_us = gap_floor;
+
+        if (++sched->successes >= sched->window) {
+            sched->successes = 0;
+            if (sched->window < window_limit) sched->window++;
+        }
+    } else {
+        sched->successes = 0;
+        if (sched->window > window_limit) sched->window = window_limit;
+        if (sched->gap_us < gap_floor) sched->gap_us = gap_floor;
+    }
+}
+
+
+static void tx_sched_retire(tx_sched_t *sched, tx_frame_t *f, bool success, uint64_t now_us) {
+    if (f->state == TX_SLOT_IN_FLIGHT) sched->in_flight--;
+    tx_sched_record(sched, f->dest, success);
+
+    if (success) {
+        sched->stats.delivered++;
+        f->state = TX_SLOT_FREE;
+        return;
+    }
+
+    sched->stats.failed++;
+
+    if (f->attempts > sched->cfg.max_retries) {
+        sched->stats.dropped++;
+        f->state = TX_SLOT_FREE;
+        return;
+    }
+
+    sched->stats.retried++;
+    f->ready_us = now_us + ((uint64_t)sched->cfg.backoff_us << (f->attempts - 1));
+    f->state = TX_SLOT_QUEUED;
+}
+
+
+tx_frame_t *tx_sched_next(tx_sched_t *sched, uint64_t now_us, uint32_t *wait_us) {
+    tx_frame_t *best = NULL;
+    uint64_t due = UINT64_MAX;
+
+    for (int i = 0; i < TX_SCHED_SLOTS; i++) {
+        tx_frame_t *f = &sched->slots[i];
+
+        if (f->state == TX_SLOT_IN_FLIGHT && sched->cfg.ack_timeout_us != 0 &&
+            now_us - f->sent_us >= sched->cfg.ack_timeout_us) {
+            sched->stats.timeouts++;
+            tx_sched_retire(sched, f, false, now_us);
+        }
+
+        if (f->state == TX_SLOT_IN_FLIGHT && sched->cfg.ack_timeout_us != 0) {
+            uint64_t t = f->sent_us + sched->cfg.ack_timeout_us;
+            if (t < due) due = t;
+        }
+
+        if (f->state != TX_SLOT_QUEUED) continue;
+
+        if (f->ready_us > now_us) {
+            if (f->ready_us < due) due = f->ready_us;
+            continue;
+        }
+
+        if (best == NULL || (int32_t)(f->order - best->order) < 0) best = f;
+    }
+
+    if (best != NULL) {
+        uint64_t pace = sched->last_send_us + sched->gap_us;
+
+        if (sched->in_flight >= sched->window) {
+            best = NULL; // a report will free the window and wake us up
+        } else if (sched->stats.sent != 0 && pace > now_us) {
+            if (pace < due) due = pace;
+            best = NULL;
+        }
+    }
+
+    if (best == NULL) {
+        *wait_us = due == UINT64_MAX ? TX_SCHED_NO_WAIT
+                 : due <= now_us ? 0
+                 : due - now_us > UINT32_MAX - 1 ? UINT32_MAX - 1 : (uint32_t)(due - now_us);
+        return NULL;
+    }
+
+    best->attempts++;
+    best->order = sched->next_order++;
+    best->sent_us = now_us;
+    best->state = TX_SLOT_IN_FLIGHT;
+    sched->in_flight++;
+    sched->last_send_us = now_us;
+    sched->stats.sent++;
+    *wait_us = 0;
+    return best;
+}
+
+
+void tx_sched_send_failed(tx_sched_t *sched, tx_frame_t *frame, uint64_t now_us) {
+    tx_sched_retire(sched, frame, false, now_us);
+}
+
+
+uint64_t tx_sched_on_status(tx_sched_t *sched, const uint8_t *dest, bool success, uint64_t now_us) {
+    tx_frame_t *oldest = NULL;
+
+    for (int i = 0; i < TX_SCHED_SLOTS; i++) {
+        tx_frame_t *f = &sched->slots[i];
+
+        if (f->state != TX_SLOT_IN_FLIGHT || memcmp(f->dest, dest, TX_SCHED_ADDR_LEN) != 0) continue;
+        if (oldest == NULL || (int32_t)(f->order - oldest->order) < 0) oldest = f;
+    }
+
+    if (oldest == NULL) {
+        sched->stats.unmatched++;
+        return 0;
+    }
+
+    uint64_t sent_us = oldest->sent_us;
+    tx_sched_retire(sched, oldest, success, now_us);
+    return sent_us;
+}
+
+
+void tx_sched_get_stats(const tx_sched_t *sched, tx_sched_stats_t *stats) {
+    *stats = sched->stats;
+    stats->window = sched->window;
+    stats->in_flight = sched->in_flight;
+    stats->gap_us = sched->gap_us;
+}
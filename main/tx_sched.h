@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Transmit scheduler driven by the ESP-NOW send-complete callback.
+//
+// Frames wait in a fixed set of slots until the window of unacknowledged
+// sends has room and the pacing gap has passed. Each send-complete report
+// retires the oldest in-flight frame for that address. Failed frames are
+// retried after an exponential backoff and dropped once out of retries.
+//
+// The window and gap follow a moving average of delivery success on the
+// channel: the gap may not close below min_gap_us scaled by the inverse
+// square of that average, the window may not open past max_window scaled
+// by it. Successes close the gap by an eighth and a full window of them
+// widens the window by one, up to those limits; a failure pulls both back
+// to them. A clear channel therefore ramps up to the configured limits, a
+// lossy one backs off in proportion to its loss rather than collapsing to
+// max_gap_us at the first sustained loss.
+// A peer that keeps failing while others get through without a failure is
+// out of range rather than the channel being busy: after
+// TX_SCHED_DEST_FAILURES failures in a row its further failures only cost
+// it retries, not everyone's window and gap.
+//
+// Not thread safe: feed callback reports in from the task that owns it.
+
+#define TX_SCHED_SLOTS              24      // room for a fan-out to every ESP-NOW peer
+#define TX_SCHED_ADDR_LEN           6       // == ESP_NOW_ETH_ALEN
+#define TX_SCHED_MTU                250     // == ESP_NOW_MAX_DATA_LEN
+#define TX_SCHED_NO_WAIT            UINT32_MAX
+#define TX_SCHED_DESTS              8       // addresses tracked while they fail
+#define TX_SCHED_DEST_FAILURES      2       // failures in a row before a peer is on its own
+
+typedef enum {
+    TX_SLOT_FREE = 0,
+    TX_SLOT_QUEUED,
+    TX_SLOT_IN_FLIGHT,
+} tx_slot_state_t;
+
+typedef struct {
+    uint8_t dest[TX_SCHED_ADDR_LEN];
+    uint8_t buf[TX_SCHED_MTU];
+    uint16_t len;
+    uint8_t state;
+    uint8_t attempts;
+    uint32_t order;             // send order, oldest in-flight frame is acked first
+    uint64_t ready_us;          // earliest (re)transmission time
+    uint64_t sent_us;
+    uint64_t origin_us;         // production of the oldest value in the frame
+} tx_frame_t;
+
+typedef struct {
+    uint8_t max_window;         // in-flight frames allowed on a clear channel
+    uint8_t max_retries;
+    uint32_t backoff_us;        // first retry delay, doubled per attempt
+    uint32_t min_gap_us;        // pacing floor between sends
+    uint32_t max_gap_us;        // pacing ceiling under loss
+    uint32_t ack_timeout_us;    // in-flight frame without report counts as failed
+} tx_sched_config_t;
+
+typedef struct {
+    uint32_t submitted;
+    uint32_t sent;              // transmissions including retries
+    uint32_t delivered;
+    uint32_t failed;            // failed transmissions
+    uint32_t retried;
+    uint32_t dropped;           // frames given up on
+    uint32_t rejected;          // submits refused because every slot was taken
+    uint32_t timeouts;
+    uint32_t unmatched;         // reports with no frame in flight for the address
+    uint32_t isolated;          // failures charged to their peer, not the channel
+    uint8_t window;
+    uint8_t in_flight;
+    uint32_t gap_us;
+    uint16_t success_permille;  // moving average of delivery success
+} tx_sched_stats_t;
+
+typedef struct {
+    uint8_t dest[TX_SCHED_ADDR_LEN];
+    uint8_t failures;           // in a row, 0 marks a free entry
+    bool shared;                // others failed during the streak too
+    uint32_t delivered_at;      // deliveries to anyone when the streak began
+} tx_dest_t;
+
+typedef struct {
+    tx_sched_config_t cfg;
+    tx_frame_t slots[TX_SCHED_SLOTS];
+    uint32_t next_order;
+    uint64_t last_send_us;
+    uint8_t window;
+    uint8_t in_flight;
+    uint8_t successes;          // towards the next window increase
+    uint32_t gap_us;
+    uint16_t channel_permille;  // success average without isolated failures
+    tx_dest_t dests[TX_SCHED_DESTS];
+    tx_sched_stats_t stats;
+} tx_sched_t;
+
+void tx_sched_init(tx_sched_t *sched, const tx_sched_config_t *cfg);
+
+uint32_t tx_sched_free_slots(const tx_sched_t *sched);
+
+// Copies the frame into a free slot. origin_us rides along with the frame
+// for end-to-end latency. Returns false when all slots are busy.
+bool tx_sched_submit(tx_sched_t *sched, const uint8_t *dest, const uint8_t *buf, uint16_t len, uint64_t origin_us, uint64_t now_us);
+
+// Returns the next frame to hand to the radio and marks it in flight, or
+// NULL. wait_us is set to how long until something may be due.
+tx_frame_t *tx_sched_next(tx_sched_t *sched, uint64_t now_us, uint32_t *wait_us);
+
+// The radio refused the frame returned by tx_sched_next.
+void tx_sched_send_failed(tx_sched_t *sched, tx_frame_t *frame, uint64_t now_us);
+
+// Send-complete report for dest. Returns the retired frame's send time, or
+// 0 if nothing was in flight for dest.
+uint64_t tx_sched_on_status(tx_sched_t *sched, const uint8_t *dest, bool success, uint64_t now_us);
+
+void tx_sched_get_stats(const tx_sched_t *sched, tx_sched_stats_t *stats);
@@ -0,0 +1,142 @@
+#include <string.h>
+
+#include "value_cache.h"
+
+#define VALUE_CACHE_VALID           0x01
+
+_Static_assert(VALUE_CACHE_TAGS < VALUE_CACHE_NO_COLUMN, "column index must fit below VALUE_CACHE_NO_COLUMN");
+
+
+void value_cache_init(value_cache_t *cache) {
+    memset(cache, 0, sizeof(*cache));
+
+    for (int tag = 0; tag < 256; tag++) {
+        atomic_init(&cache->column[tag], VALUE_CACHE_NO_COLUMN);
+    }
+}
+
+
+static void value_cache_write(value_cache_entry_t *e, uint32_t value, uint32_t time_ms, uint32_t meta) {
+    uint32_t seq = atomic_load_explicit(&e->seq, memory_order_relaxed);
+
+    // odd while the entry is inconsistent; the fence keeps the data stores
+    // from being seen before the counter
+    atomic_store_explicit(&e->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&e->value, value, memory_order_relaxed);
+    atomic_store_explicit(&e->time_ms, time_ms, memory_order_relaxed);
+    atomic_store_explicit(&e->meta, meta, memory_order_relaxed);
+
+    atomic_store_explicit(&e->seq, seq + 2, memory_order_release);
+}
+
+
+void value_cache_reset_peer(value_cache_t *cache, uint8_t peer) {
+    if (peer >= VALUE_CACHE_PEERS) return;
+    value_cache_row_t *row = &cache->rows[peer];
+
+    for (uint32_t col = 0; col < cache->columns; col++) {
+        value_cache_write(&row->entries[col], 0, 0, 0);
+    }
+
+    atomic_store_explicit(&row->frames, 0, memory_order_relaxed);
+    atomic_store_explicit(&row->gaps, 0, memory_order_relaxed);
+    atomic_store_explicit(&row->duplicates, 0, memory_order_relaxed);
+    atomic_store_explicit(&row->restarts, 0, memory_order_relaxed);
+    row->have_seq = false;
+}
+
+
+bool value_cache_begin_frame(value_cache_t *cache, uint8_t peer, uint16_t epoch, uint16_t frame_seq, uint32_t *missed) {
+    *missed = 0;
+    if (peer >= VALUE_CACHE_PEERS) return false;
+    value_cache_row_t *row = &cache->rows[peer];
+
+    if (row->have_seq && epoch != row->last_epoch) {
+        atomic_fetch_add_explicit(&row->restarts, 1, memory_order_relaxed);
+    } else if (row->have_seq) {
+        int16_t delta = (int16_t)(frame_seq - row->last_seq);
+
+        if (delta <= 0 && delta > -VALUE_CACHE_REORDER_WINDOW) {
+            atomic_fetch_add_explicit(&row->duplicates, 1, memory_order_relaxed);
+            return false;
+        }
+
+        if (delta > 1) {
+            *missed = (uint32_t)(delta - 1);
+            atomic_fetch_add_explicit(&row->gaps, *missed, memory_order_relaxed);
+        } else if (delta <= 0) {
+            atomic_fetch_add_explicit(&row->restarts, 1, memory_order_relaxed);
+        }
+    }
+
+    row->last_seq = frame_seq;
+    row->last_epoch = epoch;
+    row->have_seq = true;
+    atomic_fetch_add_explicit(&row->frames, 1, memory_order_relaxed);
+    return true;
+}
+
+
+bool value_cache_put(value_cache_t *cache, uint8_t peer, const frame_record_t *rec, uint16_t frame_seq, uint32_t now_ms) {
+    if (peer >= VALUE_CACHE_PEERS) return false;
+
+    uint8_t col = atomic_load_explicit(&cache->column[rec->tag], memory_order_relaxed);
+    if (col == VALUE_CACHE_NO_COLUMN) {
+        if (cache->columns == VALUE_CACHE_TAGS) {
+            atomic_fetch_add_explicit(&cache->no_column, 1, memory_order_relaxed);
+            return false;
+        }
+        col = (uint8_t)cache->columns++;
+        atomic_store_explicit(&cache->column[rec->tag], col, memory_order_release);
+    }
+
+    uint32_t meta = (uint32_t)frame_seq << 16 | (uint32_t)rec->len << 8 | VALUE_CACHE_VALID;
+    value_cache_write(&cache->rows[peer].entries[col], rec->value, now_ms, meta);
+    return true;
+}
+
+
+bool value_cache_get(value_cache_t *cache, uint8_t peer, uint8_t tag, value_cache_value_t *out) {
+    if (peer >= VALUE_CACHE_PEERS) return false;
+
+    uint8_t col = atomic_load_explicit(&cache->column[tag], memory_order_acquire);
+    if (col == VALUE_CACHE_NO_COLUMN) return false;
+
+    value_cache_entry_t *e = &cache->rows[peer].entries[col];
+    uint32_t seq, value, time_ms, meta;
+
+    do {
+        do {
+            seq = atomic_load_explicit(&e->seq, memory_order_acquire);
+        } while (seq & 1);
+
+        value = atomic_load_explicit(&e->value, memory_order_relaxed);
+        time_ms = atomic_load_explicit(&e->time_ms, memory_order_relaxed);
+        meta = atomic_load_explicit(&e->meta, memory_order_relaxed);
+
+        // keeps the data loads from moving below the second counter load
+        atomic_thread_fence(memory_order_acquire);
+    } while (atomic_load_explicit(&e->seq, memory_order_relaxed) != seq);
+
+    if (!(meta & VALUE_CACHE_VALID)) return false;
+
+    out->value = value;
+    out->time_ms = time_ms;
+    out->frame_seq = (uint16_t)(meta >> 16);
+    out->len = (uint8_t)(meta >> 8);
+    return true;
+}
+
+
+void value_cache_get_peer_stats(value_cache_t *cache, uint8_t peer, value_cache_peer_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (peer >= VALUE_CACHE_PEERS) return;
+    value_cache_row_t *row = &cache->rows[peer];
+
+    stats->frames = atomic_load_explicit(&row->frames, memory_order_relaxed);
+    stats->gaps = atomic_load_explicit(&row->gaps, memory_order_relaxed);
+    stats->duplicates = atomic_load_explicit(&row->duplicates, memory_order_relaxed);
+    stats->restarts = atomic_load_explicit(&row->restarts, memory_order_relaxed);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "frame_codec.h"
+
+// Latest value of every tag from every peer, filled in by the receive task
+// and read by anyone.
+//
+// Rows are peer table slots and columns are tags in the order they were
+// first seen, so a lookup is two array indexings. Each entry is a seqlock:
+// the single writer makes the counter odd while it updates the entry, and a
+// reader retries until it copies the entry with the same even counter on
+// both sides. Readers never block the writer or each other.
+//
+// The writer also follows every peer's frame sequence number. Missed frames
+// are counted as gaps; repeated and late frames are counted and their
+// records are not applied, so an old value never overwrites a newer one.
+// A new sender epoch is a reboot: the sequence starts over wherever the old
+// one had got to, without counting gaps or dropping frames.
+//
+// One writer only.
+
+#define VALUE_CACHE_PEERS           20      // == PEER_TABLE_MAX
+#define VALUE_CACHE_TAGS            16
+#define VALUE_CACHE_NO_COLUMN       0xFF
+#define VALUE_CACHE_REORDER_WINDOW  32      // a jump back further than this within one epoch is a restart that drew the same epoch
+
+typedef struct {
+    uint32_t value;
+    uint32_t time_ms;           // when the frame carrying it was decoded
+    uint16_t frame_seq;
+    uint8_t len;
+} value_cache_value_t;
+
+typedef struct {
+    uint32_t frames;            // frames applied
+    uint32_t gaps;              // frames missed between applied ones
+    uint32_t duplicates;        // repeated or late frames, not applied
+    uint32_t restarts;          // sequence restarts of the sender
+} value_cache_peer_stats_t;
+
+typedef struct {
+    atomic_uint_least32_t seq;
+    atomic_uint_least32_t value;
+    atomic_uint_least32_t time_ms;
+    atomic_uint_least32_t meta;         // frame seq << 16 | len << 8 | valid
+} __attribute__((aligned(16))) value_cache_entry_t;
+
+typedef struct {
+    value_cache_entry_t entries[VALUE_CACHE_TAGS];
+    atomic_uint_least32_t frames;
+    atomic_uint_least32_t gaps;
+    atomic_uint_least32_t duplicates;
+    atomic_uint_least32_t restarts;
+    uint16_t last_seq;                  // writer only
+    uint16_t last_epoch;                // writer only
+    bool have_seq;                      // writer only
+} value_cache_row_t;
+
+typedef struct {
+    atomic_uint_least8_t column[256];   // tag to column
+    uint32_t columns;                   // writer only
+    atomic_uint_least32_t no_column;    // records dropped because every column was taken
+    value_cache_row_t rows[VALUE_CACHE_PEERS];
+} value_cache_t;
+
+void value_cache_init(value_cache_t *cache);
+
+// Writer side. Forgets everything about a peer slot, for when it is handed
+// to a new peer.
+void value_cache_reset_peer(value_cache_t *cache, uint8_t peer);
+
+// Writer side. Checks a frame's epoch and sequence number against the
+// peer's last ones and returns whether the frame's records should be
+// applied. *missed is set to the number of frames skipped since the last
+// accepted one.
+bool value_cache_begin_frame(value_cache_t *cache, uint8_t peer, uint16_t epoch, uint16_t frame_seq, uint32_t *missed);
+
+// Writer side. Stores one record of a frame that value_cache_begin_frame
+// accepted. Returns false when the tag has no column left.
+bool value_cache_put(value_cache_t *cache, uint8_t peer, const frame_record_t *rec, uint16_t frame_seq, uint32_t now_ms);
+
+// Reader side. Copies the latest value of tag from peer; false if there is none.
+bool value_cache_get(value_cache_t *cache, uint8_t peer, uint8_t tag, value_cache_value_t *out);
+
+void value_cache_get_peer_stats(value_cache_t *cache, uint8_t peer, value_cache_peer_stats_t *stats);
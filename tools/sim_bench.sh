@@ -0,0 +1,75 @@
+#!/bin/sh
+# Runs the application on the simulated medium (linux target) in the four
+# send configurations, broadcast or unicast fan-out, each with and without
+# coalescing, and prints their last telemetry side by side.
+#
+#   . $IDF_PATH/export.sh
+#   tools/sim_bench.sh [seconds] [loss_permille]
+#
+# Every configuration gets its own build directory under build_sim/ and
+# runs there, so saved radio state does not leak from one run to the next.
+
+set -e
+
+duration=${1:-30}
+loss=${2:-20}
+root=$(cd "$(dirname "$0")/.." && pwd)
+out="$root/build_sim"
+
+configs="broadcast_batched broadcast_unbatched unicast_batched unicast_unbatched"
+
+write_defaults() {
+    name=$1
+    file=$2
+
+    {
+        echo "CONFIG_ESPNOW_SIM_DURATION_S=$duration"
+        echo "CONFIG_ESPNOW_SIM_LOSS_PERMILLE=$loss"
+        case $name in
+            unicast_*) echo "CONFIG_ESPNOW_UNICAST_FANOUT=y" ;;
+            *)         echo "# CONFIG_ESPNOW_UNICAST_FANOUT is not set" ;;
+        esac
+        case $name in
+            *_batched) echo "CONFIG_ESPNOW_SEND_COALESCE=y" ;;
+            *)         echo "# CONFIG_ESPNOW_SEND_COALESCE is not set" ;;
+        esac
+    } > "$file"
+}
+
+for name in $configs; do
+    dir="$out/$name"
+    mkdir -p "$dir"
+    write_defaults "$name" "$dir/sdkconfig.defaults"
+    rm -f "$dir/sdkconfig"
+
+    echo ">> Building $name" >&2
+    idf.py --preview -C "$root" -B "$dir/build" -DIDF_TARGET=linux \
+        -DSDKCONFIG="$dir/sdkconfig" -DSDKCONFIG_DEFAULTS="$dir/sdkconfig.defaults" build > "$dir/build.log" 2>&1 ||
+        { echo ">> Error: build of $name failed, see $dir/build.log" >&2; exit 1; }
+
+    echo ">> Running $name for $duration s" >&2
+    rm -f "$dir"/*.bin
+    (cd "$dir" && ./build/espnow_conn_test.elf > run.log 2>&1) || true
+done
+
+# The last telemetry pair of each run: the counter line and the rate line
+printf '%-20s %8s %8s %8s %8s %7s %9s %9s %9s %9s %9s\n' config tx_rec rec_drop tx tx_ok tx_fps cpu_us/f \
+    ack_p50 ack_p99 e2e_p50 e2e_p99
+for name in $configs; do
+    awk -v name="$name" '
+        { gsub(/\033\[[0-9;]*m/, "") }
+        /TELEMETRY: status=/ { counters = $0 }
+        /TELEMETRY: tx_fps=/ { rates = $0 }
+        function field(line, key,    i, n, kv) {
+            n = split(line, kv, " ")
+            for (i = 1; i <= n; i++) if (index(kv[i], key "=") == 1) return substr(kv[i], length(key) + 2)
+            return "-"
+        }
+        END {
+            printf "%-20s %8s %8s %8s %8s %7s %9s %9s %9s %9s %9s\n", name,
+                field(counters, "tx_rec"), field(counters, "tx_rec_drop"), field(counters, "tx"),
+                field(counters, "tx_ok"), field(rates, "tx_fps"), field(rates, "cpu_us_per_frame"),
+                field(counters, "ack_lat_p50"), field(counters, "ack_lat_p99"),
+                field(counters, "e2e_lat_p50"), field(counters, "e2e_lat_p99")
+        }' "$out/$name/run.log"
+done